@@ -0,0 +1,100 @@
+#!/bin/sh
+# Vocabulary-scaling benchmark: generates Zipf corpora over a grid of
+# vocabulary sizes and exponents, runs the naive, multiprocessing,
+# multithreading and hybrid engines on each, and checks that they all
+# report identical counts. externalAggregation also runs once per corpus on
+# a budget and open file limit small enough that its merges need
+# intermediate passes. Each engine runs once per memory backend in
+# MEMORY_MODES ("default" is base pages, see WORDCOUNT_MEMORY in the README)
+# so page faults and dTLB load misses can be compared side by side. Override
+# the grid through the environment, e.g.
+#   TOKENS=2000000 VOCABS="1000 10000 100000" EXPONENTS="0.8 1.2" ./benchmark.sh
+
+set -e
+export LC_ALL=C
+
+TOKENS=${TOKENS:-200000}
+VOCABS=${VOCABS:-"1000 10000 50000"}
+EXPONENTS=${EXPONENTS:-"0.8 1.0 1.2"}
+MEAN_LENGTH=${MEAN_LENGTH:-6}
+LENGTH_DIST=${LENGTH_DIST:-geometric}
+SEED=${SEED:-42}
+WORK_DIR=${WORK_DIR:-bench}
+MEMORY_MODES=${MEMORY_MODES:-"default huge,prefault"}
+
+# externalAggregation: the smallest budget its workers accept, and an open
+# file limit that caps each of their merges at two runs
+SPILL_BUDGET_MB=4
+SPILL_WORKERS=8
+SPILL_FILES=40
+
+SRC_DIR=$(cd "$(dirname "$0")" && pwd)
+mkdir -p "$WORK_DIR" "$WORK_DIR/spill"
+
+# Build everything with the project Makefile (honours CC and CFLAGS)
+make -s -C "$SRC_DIR" all
+
+failures=0
+row="%-8s %-6s %-10s %-26s %-14s %10s %12s %14s %s\n"
+printf "$row" "vocab" "s" "distinct" "engine" "memory" "seconds" "page faults" "dTLB misses" "counts"
+
+for vocab in $VOCABS; do
+    for s in $EXPONENTS; do
+        corpus="$WORK_DIR/zipf-v$vocab-s$s.txt"
+        "$SRC_DIR/zipfGenerator" -n "$TOKENS" -v "$vocab" -s "$s" -l "$MEAN_LENGTH" \
+            -d "$LENGTH_DIST" -r "$SEED" -o "$corpus"
+
+        # Reference counts, independent of all three engines
+        tr -s ' \n' '\n\n' < "$corpus" | sed '/^$/d' | sort | uniq -c |
+            awk '{ print $2 "\t" $1 }' > "$WORK_DIR/expected.tsv"
+        distinct=$(wc -l < "$WORK_DIR/expected.tsv")
+
+        for engine in naiveApproach multiprocessingApproach multithreadingApproach hybridApproach; do
+            for memory in $MEMORY_MODES; do
+                counts="$WORK_DIR/$engine.tsv"
+                output=$(WORDCOUNT_MEMORY=$memory "$SRC_DIR/$engine" "$corpus" "$counts")
+                seconds=$(echo "$output" | sed -n 's/^Execution Time: \([0-9.]*\) seconds$/\1/p')
+                faults=$(echo "$output" | sed -n 's/^Memory: .*, \([0-9]*\) page faults, .*$/\1/p')
+                misses=$(echo "$output" | sed -n 's/^Memory: .* page faults, \([0-9]*\) dTLB .*$/\1/p')
+
+                if sort "$counts" | cmp -s - "$WORK_DIR/expected.tsv"; then
+                    verdict="ok"
+                else
+                    verdict="MISMATCH"
+                    failures=$((failures + 1))
+                fi
+                printf "$row" "$vocab" "$s" "$distinct" "$engine" "$memory" "$seconds" \
+                    "$faults" "${misses:-n/a}" "$verdict"
+            done
+        done
+
+        # Every worker spills at least its final table, so with more workers
+        # than the merge fan-in each partition goes through intermediate runs
+        counts="$WORK_DIR/externalAggregation.tsv"
+        output=$(ulimit -n "$SPILL_FILES" && "$SRC_DIR/externalAggregation" "$corpus" \
+            "$SPILL_BUDGET_MB" "$SPILL_WORKERS" "$WORK_DIR/spill" "$counts")
+        seconds=$(echo "$output" | sed -n 's/^Execution Time: \([0-9.]*\) seconds$/\1/p')
+        runs=$(echo "$output" | sed -n 's/^Spilled Runs: \([0-9]*\)$/\1/p')
+        merged=$(echo "$output" | sed -n 's/^Merge Fan-In: [0-9]* (\([0-9]*\) intermediate runs)$/\1/p')
+
+        if ! sort "$counts" | cmp -s - "$WORK_DIR/expected.tsv"; then
+            verdict="MISMATCH"
+            failures=$((failures + 1))
+        elif [ "${merged:-0}" -eq 0 ]; then
+            verdict="NO INTERMEDIATE MERGE"
+            failures=$((failures + 1))
+        else
+            verdict="ok ($runs spills, $merged intermediate runs)"
+        fi
+        printf "$row" "$vocab" "$s" "$distinct" "externalAggregation" "${SPILL_BUDGET_MB}MB budget" \
+            "$seconds" "n/a" "n/a" "$verdict"
+        rm -f "$corpus"
+    done
+done
+
+if [ "$failures" -ne 0 ]; then
+    echo "$failures engine run(s) produced counts that differ from the reference" \
+        "or skipped intermediate merges"
+    exit 1
+fi
+echo "All engines produced identical counts"
@@ -0,0 +1,825 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#define MAX_WORD_LENGTH 60
+#define TOP_K 10
+#define GROWTH_FACTOR 2
+#define NUM_THREADS 8
+#define DEFAULT_BUDGET_MB 64
+#define INITIAL_TABLE_SLOTS 4096
+#define ARENA_BLOCK_SIZE (1 << 16)
+#define RUN_BUFFER_SIZE (1 << 16)
+#define RESERVED_FDS 16             // stdio, the input and whatever else the process holds
+#define MIN_MERGE_FAN_IN 2
+#define MIN_BUDGET_FACTOR 2         // a worker's budget must hold its fixed buffers twice over
+
+/*
+ * Memory-budgeted word counting. Each worker counts a byte range of the input
+ * in a hash table; when the table and its key storage exceed the worker's
+ * share of the budget, the table is spilled to disk as sorted runs of
+ * (word, count), one run file per merge partition, and then cleared. After
+ * counting, one merge thread per partition k-way merges that partition's
+ * runs into exact counts, keeping a local top-K. A merge reads at most
+ * `fan_in` runs at once, with `fan_in` derived from the budget and the open
+ * file limit; partitions with more runs are merged in several passes through
+ * intermediate runs, so resident memory stays within the budget. Run files
+ * are registered before they are written and removed on every exit path.
+ *
+ * Run file record: uint16_t len, char word[len], uint64_t count.
+ */
+
+// Hash table entry, the key lives in the owning table's arena
+typedef struct {
+    char *word;
+    uint64_t hash;
+    uint64_t count;
+} CountEntry;
+
+// Block of key storage, freed all at once when the table is spilled
+typedef struct ArenaBlock {
+    struct ArenaBlock *next;
+    size_t used;
+    char data[ARENA_BLOCK_SIZE];
+} ArenaBlock;
+
+// Per-worker counting table with a memory budget
+typedef struct {
+    CountEntry *slots;
+    size_t mask;
+    size_t size;
+    ArenaBlock *arena;
+    size_t memory;
+    size_t budget;
+} CountTable;
+
+// Run files written so far for one merge partition
+typedef struct {
+    char **paths;
+    int size;
+    int capacity;
+} RunList;
+
+typedef struct {
+    char word[MAX_WORD_LENGTH];
+    uint64_t count;
+} TopEntry;
+
+// Worker argument structure
+typedef struct {
+    int id;
+    long start;
+    long end;
+    size_t budget;
+    uint64_t total_words;
+    size_t peak_memory;
+    int runs;
+} WorkerArgs;
+
+// Merge thread argument structure
+typedef struct {
+    int partition;
+    int intermediate_runs;
+    uint64_t distinct_words;
+    int top_size;
+    TopEntry top[TOP_K];
+    char output_path[4096];
+} MergeArgs;
+
+// Reader for one run file during the k-way merge
+typedef struct {
+    FILE *file;
+    char *buffer;
+    char word[MAX_WORD_LENGTH];
+    uint64_t count;
+} RunReader;
+
+static const char *input_path;
+static const char *temp_dir;
+static const char *output_path;
+static int num_partitions;
+static int fan_in;
+static RunList *partition_runs;
+static MergeArgs *merges;
+static pthread_mutex_t runs_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int failed;                  // set by any thread hitting an I/O error
+
+// Record a failure; threads stop at their next check and main cleans up
+void fail(const char *message) {
+    perror(message);
+    __atomic_store_n(&failed, 1, __ATOMIC_RELAXED);
+}
+
+int has_failed(void) {
+    return __atomic_load_n(&failed, __ATOMIC_RELAXED);
+}
+
+// Remove every run and partition output still on disk. Registered with
+// atexit, so it also runs when an allocation failure calls exit().
+void remove_temp_files(void) {
+    pthread_mutex_lock(&runs_mutex);
+    for (int p = 0; partition_runs && p < num_partitions; p++) {
+        for (int i = 0; i < partition_runs[p].size; i++) {
+            unlink(partition_runs[p].paths[i]);
+        }
+        partition_runs[p].size = 0;
+        if (merges && merges[p].output_path[0]) {
+            unlink(merges[p].output_path);
+        }
+    }
+    pthread_mutex_unlock(&runs_mutex);
+}
+
+// FNV-1a hash of a word
+static uint64_t hash_word(const char *word, size_t len) {
+    uint64_t h = 1469598103934665603ULL;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)word[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+void* checked_malloc(size_t size) {
+    void *result = malloc(size);
+    if (!result) {
+        perror("Memory allocation failed");
+        exit(1);
+    }
+    return result;
+}
+
+void init_count_table(CountTable *table, size_t budget) {
+    table->mask = INITIAL_TABLE_SLOTS - 1;
+    table->slots = calloc(INITIAL_TABLE_SLOTS, sizeof(CountEntry));
+    if (!table->slots) {
+        perror("Memory allocation failed");
+        exit(1);
+    }
+    table->size = 0;
+    table->arena = NULL;
+    table->memory = INITIAL_TABLE_SLOTS * sizeof(CountEntry);
+    table->budget = budget;
+}
+
+// Copy a key into the table's arena
+char* arena_store(CountTable *table, const char *word, size_t len) {
+    ArenaBlock *block = table->arena;
+    if (!block || block->used + len + 1 > ARENA_BLOCK_SIZE) {
+        block = checked_malloc(sizeof(ArenaBlock));
+        block->next = table->arena;
+        block->used = 0;
+        table->arena = block;
+        table->memory += sizeof(ArenaBlock);
+    }
+    char *copy = block->data + block->used;
+    memcpy(copy, word, len + 1);
+    block->used += len + 1;
+    return copy;
+}
+
+// Double the slot array once it is half full
+void grow_count_table(CountTable *table) {
+    size_t new_capacity = (table->mask + 1) * GROWTH_FACTOR;
+    CountEntry *slots = calloc(new_capacity, sizeof(CountEntry));
+    if (!slots) {
+        perror("Memory allocation failed");
+        exit(1);
+    }
+    for (size_t i = 0; i <= table->mask; i++) {
+        if (!table->slots[i].word) continue;
+        size_t slot = table->slots[i].hash & (new_capacity - 1);
+        while (slots[slot].word) {
+            slot = (slot + 1) & (new_capacity - 1);
+        }
+        slots[slot] = table->slots[i];
+    }
+    free(table->slots);
+    table->memory += (new_capacity - table->mask - 1) * sizeof(CountEntry);
+    table->slots = slots;
+    table->mask = new_capacity - 1;
+}
+
+// Count one occurrence; returns 1 once the table must be spilled
+int add_word_to_table(CountTable *table, const char *word, size_t len) {
+    uint64_t hash = hash_word(word, len);
+    size_t slot = hash & table->mask;
+    while (table->slots[slot].word) {
+        if (table->slots[slot].hash == hash && strcmp(table->slots[slot].word, word) == 0) {
+            table->slots[slot].count++;
+            return 0;
+        }
+        slot = (slot + 1) & table->mask;
+    }
+
+    table->slots[slot].word = arena_store(table, word, len);
+    table->slots[slot].hash = hash;
+    table->slots[slot].count = 1;
+    table->size++;
+
+    // Spill rather than grow past the budget, so the slot array always fits
+    if (table->size * 2 > table->mask) {
+        size_t grown = table->memory + (table->mask + 1) * (GROWTH_FACTOR - 1) * sizeof(CountEntry);
+        if (grown > table->budget) {
+            return 1;
+        }
+        grow_count_table(table);
+    }
+    return table->memory > table->budget;
+}
+
+int compare_entries_by_word(const void *a, const void *b) {
+    return strcmp(((const CountEntry*)a)->word, ((const CountEntry*)b)->word);
+}
+
+// Register a run file for its partition before it is created, so it is
+// cleaned up even if writing it fails
+void register_run(int partition, const char *path) {
+    pthread_mutex_lock(&runs_mutex);
+    RunList *list = &partition_runs[partition];
+    char *copy = strdup(path);
+    if (list->size >= list->capacity) {
+        list->capacity = list->capacity ? list->capacity * GROWTH_FACTOR : 16;
+        char **paths = realloc(list->paths, list->capacity * sizeof(char*));
+        if (paths) {
+            list->paths = paths;
+        } else {
+            free(copy);
+            copy = NULL;
+        }
+    }
+    if (!copy) {
+        pthread_mutex_unlock(&runs_mutex);
+        perror("Memory allocation failed");
+        exit(1);
+    }
+    list->paths[list->size++] = copy;
+    pthread_mutex_unlock(&runs_mutex);
+}
+
+// Delete the first `n` runs of a partition once they have been merged
+void remove_runs(int partition, int n) {
+    pthread_mutex_lock(&runs_mutex);
+    RunList *list = &partition_runs[partition];
+    for (int i = 0; i < n; i++) {
+        unlink(list->paths[i]);
+        free(list->paths[i]);
+    }
+    list->size -= n;
+    memmove(list->paths, list->paths + n, list->size * sizeof(char*));
+    pthread_mutex_unlock(&runs_mutex);
+}
+
+// Append one (word, count) record to a run file
+int write_record(FILE *file, const char *word, uint64_t count) {
+    uint16_t len = (uint16_t)strlen(word);
+    return fwrite(&len, sizeof(len), 1, file) == 1 &&
+           fwrite(word, 1, len, file) == len &&
+           fwrite(&count, sizeof(uint64_t), 1, file) == 1;
+}
+
+// Write the table out as one sorted run per non-empty partition and clear
+// it, returns 0 on an I/O error
+int spill_count_table(CountTable *table, int worker, int run) {
+    if (table->size == 0) {
+        return 1;
+    }
+
+    // Compact the occupied slots to the front of the slot array
+    size_t n = 0;
+    for (size_t i = 0; i <= table->mask; i++) {
+        if (table->slots[i].word) {
+            table->slots[n++] = table->slots[i];
+        }
+    }
+    qsort(table->slots, n, sizeof(CountEntry), compare_entries_by_word);
+
+    // Partitions this spill has no words for get no run file
+    int *partition_sizes = calloc(num_partitions, sizeof(int));
+    if (!partition_sizes) {
+        perror("Memory allocation failed");
+        exit(1);
+    }
+    for (size_t i = 0; i < n; i++) {
+        partition_sizes[table->slots[i].hash % num_partitions]++;
+    }
+
+    int ok = 1;
+    char *buffer = checked_malloc(RUN_BUFFER_SIZE);
+    for (int p = 0; p < num_partitions && ok; p++) {
+        if (partition_sizes[p] == 0) continue;
+
+        char path[4096];
+        snprintf(path, sizeof(path), "%s/wordcount-%d-w%d-r%d-p%d.run",
+                 temp_dir, (int)getpid(), worker, run, p);
+        register_run(p, path);
+        FILE *file = fopen(path, "wb");
+        if (!file) {
+            fail("Error creating run file");
+            ok = 0;
+            break;
+        }
+        setvbuf(file, buffer, _IOFBF, RUN_BUFFER_SIZE);
+
+        for (size_t i = 0; i < n && ok; i++) {
+            if ((int)(table->slots[i].hash % num_partitions) != p) continue;
+            ok = write_record(file, table->slots[i].word, table->slots[i].count);
+        }
+
+        if (fclose(file) != 0 || !ok) {
+            fail("Error writing run file");
+            ok = 0;
+        }
+    }
+    free(buffer);
+    free(partition_sizes);
+
+    // Release keys and reset the table to empty
+    while (table->arena) {
+        ArenaBlock *next = table->arena->next;
+        free(table->arena);
+        table->arena = next;
+    }
+    memset(table->slots, 0, (table->mask + 1) * sizeof(CountEntry));
+    table->memory = (table->mask + 1) * sizeof(CountEntry);
+    table->size = 0;
+    return ok;
+}
+
+// Read the next whitespace-separated token; words longer than the buffer are
+// split into pieces like fscanf("%59s") does. Returns the token length, or 0
+// once the next word starts at or after `end`.
+size_t read_token(FILE *file, long *position, long end, int *mid_word, char *buffer) {
+    int c;
+    if (!*mid_word) {
+        while ((c = getc_unlocked(file)) != EOF && isspace(c)) {
+            (*position)++;
+        }
+        if (c == EOF || *position >= end) {
+            return 0;
+        }
+    } else {
+        c = getc_unlocked(file);
+    }
+
+    size_t len = 0;
+    while (c != EOF && !isspace(c)) {
+        buffer[len++] = (char)c;
+        (*position)++;
+        if (len == MAX_WORD_LENGTH - 1) {
+            break;
+        }
+        c = getc_unlocked(file);
+    }
+
+    if (len == MAX_WORD_LENGTH - 1) {
+        // Stop mid-word; the rest of it is the next token
+        c = getc_unlocked(file);
+        *mid_word = (c != EOF && !isspace(c));
+        if (c != EOF) ungetc(c, file);
+    } else {
+        *mid_word = 0;
+        if (c != EOF) (*position)++;
+    }
+    buffer[len] = '\0';
+    return len;
+}
+
+// Worker: count the words starting inside [start, end), spilling over budget
+void* count_worker(void *arg) {
+    WorkerArgs *args = arg;
+    FILE *file = fopen(input_path, "r");
+    if (!file) {
+        fail("Error opening file");
+        return NULL;
+    }
+
+    long position = args->start;
+    fseek(file, position, SEEK_SET);
+
+    // A word straddling the range start belongs to the previous worker
+    if (position > 0) {
+        fseek(file, position - 1, SEEK_SET);
+        int c = getc_unlocked(file);
+        if (!isspace(c)) {
+            while ((c = getc_unlocked(file)) != EOF && !isspace(c)) {
+                position++;
+            }
+            position++;
+        }
+    }
+
+    CountTable table;
+    init_count_table(&table, args->budget);
+
+    char buffer[MAX_WORD_LENGTH];
+    int mid_word = 0;
+    size_t len;
+    while ((len = read_token(file, &position, args->end, &mid_word, buffer)) > 0) {
+        int full = add_word_to_table(&table, buffer, len);
+        args->total_words++;
+
+        if (table.memory > args->peak_memory) {
+            args->peak_memory = table.memory;
+        }
+        if (full && !spill_count_table(&table, args->id, args->runs++)) {
+            break;
+        }
+        if (has_failed()) {
+            break;
+        }
+    }
+
+    if (table.size > 0 && !has_failed()) {
+        spill_count_table(&table, args->id, args->runs++);
+    }
+
+    // Keys left behind by an aborted run
+    while (table.arena) {
+        ArenaBlock *next = table.arena->next;
+        free(table.arena);
+        table.arena = next;
+    }
+    free(table.slots);
+    fclose(file);
+    return NULL;
+}
+
+// Read the next record, returns 1, 0 at the end of the run or -1 if the
+// run is corrupt
+int reader_advance(RunReader *reader) {
+    uint16_t len;
+    if (fread(&len, sizeof(len), 1, reader->file) != 1) {
+        return 0;
+    }
+    if (len >= MAX_WORD_LENGTH ||
+        fread(reader->word, 1, len, reader->file) != len ||
+        fread(&reader->count, sizeof(uint64_t), 1, reader->file) != 1) {
+        fprintf(stderr, "Corrupt run file\n");
+        __atomic_store_n(&failed, 1, __ATOMIC_RELAXED);
+        return -1;
+    }
+    reader->word[len] = '\0';
+    return 1;
+}
+
+// Restore the min-heap of readers (ordered by current word) below `pos`
+void reader_sift_down(RunReader **heap, int size, int pos) {
+    for (;;) {
+        int smallest = pos;
+        int left = 2 * pos + 1;
+        int right = left + 1;
+        if (left < size && strcmp(heap[left]->word, heap[smallest]->word) < 0) smallest = left;
+        if (right < size && strcmp(heap[right]->word, heap[smallest]->word) < 0) smallest = right;
+        if (smallest == pos) return;
+        RunReader *tmp = heap[pos];
+        heap[pos] = heap[smallest];
+        heap[smallest] = tmp;
+        pos = smallest;
+    }
+}
+
+// Offer a merged word to a partition's top-K min-heap (ordered by count)
+void offer_top_k(MergeArgs *args, const char *word, uint64_t count) {
+    TopEntry *top = args->top;
+    int pos;
+    if (args->top_size < TOP_K) {
+        pos = args->top_size++;
+        while (pos > 0 && top[(pos - 1) / 2].count > count) {
+            top[pos] = top[(pos - 1) / 2];
+            pos = (pos - 1) / 2;
+        }
+    } else if (count > top[0].count) {
+        pos = 0;
+        for (;;) {
+            int child = 2 * pos + 1;
+            if (child >= TOP_K) break;
+            if (child + 1 < TOP_K && top[child + 1].count < top[child].count) child++;
+            if (top[child].count >= count) break;
+            top[pos] = top[child];
+            pos = child;
+        }
+    } else {
+        return;
+    }
+    strcpy(top[pos].word, word);
+    top[pos].count = count;
+}
+
+// K-way merge `n` sorted runs. With a `run_path` the merged counts are
+// written as a new run, otherwise they are final: counted, offered to the
+// top-K and written to the partition output. Returns 0 on an error.
+int merge_runs(MergeArgs *args, char **paths, int n, const char *run_path) {
+    RunReader *readers = checked_malloc((n + 1) * sizeof(RunReader));
+    RunReader **heap = checked_malloc((n + 1) * sizeof(RunReader*));
+    int heap_size = 0;
+    int opened = 0;
+    int ok = 1;
+
+    for (; opened < n && ok; opened++) {
+        readers[opened].file = fopen(paths[opened], "rb");
+        if (!readers[opened].file) {
+            fail("Error opening run file");
+            ok = 0;
+            break;
+        }
+        readers[opened].buffer = checked_malloc(RUN_BUFFER_SIZE);
+        setvbuf(readers[opened].file, readers[opened].buffer, _IOFBF, RUN_BUFFER_SIZE);
+        int status = reader_advance(&readers[opened]);
+        if (status > 0) {
+            heap[heap_size++] = &readers[opened];
+        }
+        ok = status >= 0;
+    }
+    for (int i = heap_size / 2 - 1; i >= 0; i--) {
+        reader_sift_down(heap, heap_size, i);
+    }
+
+    FILE *output = NULL;
+    char *output_buffer = NULL;
+    const char *target = run_path ? run_path : (output_path ? args->output_path : NULL);
+    if (ok && target) {
+        output = fopen(target, run_path ? "wb" : "w");
+        if (!output) {
+            fail("Error creating output file");
+            ok = 0;
+        } else {
+            output_buffer = checked_malloc(RUN_BUFFER_SIZE);
+            setvbuf(output, output_buffer, _IOFBF, RUN_BUFFER_SIZE);
+        }
+    }
+
+    // Pop equal words off the heap and sum their counts
+    char word[MAX_WORD_LENGTH];
+    while (ok && heap_size > 0) {
+        strcpy(word, heap[0]->word);
+        uint64_t count = 0;
+        while (ok && heap_size > 0 && strcmp(heap[0]->word, word) == 0) {
+            count += heap[0]->count;
+            int status = reader_advance(heap[0]);
+            if (status == 0) {
+                heap[0] = heap[--heap_size];
+            }
+            ok = status >= 0;
+            reader_sift_down(heap, heap_size, 0);
+        }
+
+        if (run_path) {
+            if (ok && !write_record(output, word, count)) {
+                fail("Error writing run file");
+                ok = 0;
+            }
+        } else {
+            args->distinct_words++;
+            offer_top_k(args, word, count);
+            if (output) {
+                fprintf(output, "%s\t%llu\n", word, (unsigned long long)count);
+            }
+        }
+        if (has_failed()) {
+            ok = 0;
+        }
+    }
+
+    if (output) {
+        if (fclose(output) != 0 && ok) {
+            fail("Error writing output file");
+            ok = 0;
+        }
+        free(output_buffer);
+    }
+    for (int i = 0; i < opened; i++) {
+        fclose(readers[i].file);
+        free(readers[i].buffer);
+    }
+    free(readers);
+    free(heap);
+    return ok;
+}
+
+// Merge thread: reduce a partition's runs `fan_in` at a time until one pass
+// can merge the rest into exact counts
+void* merge_partition(void *arg) {
+    MergeArgs *args = arg;
+    RunList *list = &partition_runs[args->partition];
+
+    // Only this thread touches the partition's list now; the lock keeps it
+    // consistent for the cleanup handler
+    while (list->size > fan_in && !has_failed()) {
+        char path[4096];
+        snprintf(path, sizeof(path), "%s/wordcount-%d-m%d-%d.run",
+                 temp_dir, (int)getpid(), args->partition, args->intermediate_runs++);
+        register_run(args->partition, path);
+        if (!merge_runs(args, list->paths, fan_in, path)) {
+            return NULL;
+        }
+        remove_runs(args->partition, fan_in);
+    }
+
+    if (!has_failed() && merge_runs(args, list->paths, list->size, NULL)) {
+        remove_runs(args->partition, list->size);
+    }
+    return NULL;
+}
+
+int compare_top_entries(const void *a, const void *b) {
+    const TopEntry *x = a;
+    const TopEntry *y = b;
+    if (x->count != y->count) {
+        return (x->count < y->count) ? 1 : -1;
+    }
+    return strcmp(x->word, y->word);
+}
+
+// Append a partition's output file to the final output and remove it
+void append_partition_output(FILE *output, const char *path) {
+    FILE *part = fopen(path, "r");
+    if (!part) {
+        perror("Error opening partition output");
+        return;
+    }
+    char buffer[RUN_BUFFER_SIZE];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), part)) > 0) {
+        fwrite(buffer, 1, n, output);
+    }
+    fclose(part);
+    unlink(path);
+}
+
+int main(int argc, char *argv[]) {
+    input_path = argc > 1 ? argv[1] : "text8.txt";
+    long budget_mb = argc > 2 ? atol(argv[2]) : DEFAULT_BUDGET_MB;
+    int num_workers = argc > 3 ? atoi(argv[3]) : NUM_THREADS;
+    temp_dir = argc > 4 ? argv[4] : "/tmp";
+    output_path = argc > 5 ? argv[5] : NULL;
+    if (budget_mb < 1 || num_workers < 1) {
+        fprintf(stderr, "Usage: %s [file] [budget_mb] [workers] [temp_dir] [counts_output]\n", argv[0]);
+        return 1;
+    }
+
+    // Start timing execution
+    struct timeval start, end;
+    gettimeofday(&start, NULL);
+
+    struct stat st;
+    if (stat(input_path, &st) != 0) {
+        perror("Error opening file");
+        return 1;
+    }
+
+    // Each worker's empty table, first arena block and spill buffer are
+    // allocated whatever the budget; a share smaller than that would spill
+    // on every token
+    size_t worker_budget = (size_t)budget_mb * 1024 * 1024 / num_workers;
+    size_t fixed_memory = INITIAL_TABLE_SLOTS * sizeof(CountEntry) + sizeof(ArenaBlock) + RUN_BUFFER_SIZE;
+    if (worker_budget < MIN_BUDGET_FACTOR * fixed_memory) {
+        size_t minimum = MIN_BUDGET_FACTOR * fixed_memory * num_workers;
+        fprintf(stderr, "Budget too small: %d workers need at least %zu MB\n",
+                num_workers, (minimum + 1024 * 1024 - 1) / (1024 * 1024));
+        return 1;
+    }
+
+    // Merge fan-in: one read buffer per open run plus one output buffer must
+    // fit a partition's share of the budget, and one descriptor per open run
+    // plus the output per merge thread must fit the open file limit
+    num_partitions = num_workers;
+    fan_in = (int)(worker_budget / RUN_BUFFER_SIZE) - 1;
+    struct rlimit files;
+    if (getrlimit(RLIMIT_NOFILE, &files) == 0 && files.rlim_cur != RLIM_INFINITY) {
+        long available = ((long)files.rlim_cur - RESERVED_FDS) / num_partitions - 1;
+        if (available < fan_in) {
+            fan_in = (int)available;
+        }
+    }
+    if (fan_in < MIN_MERGE_FAN_IN) {
+        fprintf(stderr, "Open file limit too low to merge %d partitions\n", num_partitions);
+        return 1;
+    }
+
+    partition_runs = calloc(num_partitions, sizeof(RunList));
+    WorkerArgs *workers = calloc(num_workers, sizeof(WorkerArgs));
+    merges = calloc(num_partitions, sizeof(MergeArgs));
+    pthread_t *threads = checked_malloc(num_workers * sizeof(pthread_t));
+    if (!partition_runs || !workers || !merges) {
+        perror("Memory allocation failed");
+        return 1;
+    }
+    atexit(remove_temp_files);
+
+    // Counting phase: split the file into byte ranges, one per worker
+    for (int i = 0; i < num_workers; i++) {
+        workers[i].id = i;
+        workers[i].start = (long)(st.st_size * (double)i / num_workers);
+        workers[i].end = (long)(st.st_size * (double)(i + 1) / num_workers);
+        workers[i].budget = worker_budget;
+        if (pthread_create(&threads[i], NULL, count_worker, &workers[i]) != 0) {
+            perror("Thread creation failed");
+            exit(1);
+        }
+    }
+
+    uint64_t total_words = 0;
+    size_t peak_table_memory = 0;
+    int total_runs = 0;
+    for (int i = 0; i < num_workers; i++) {
+        pthread_join(threads[i], NULL);
+        total_words += workers[i].total_words;
+        total_runs += workers[i].runs;
+        if (workers[i].peak_memory > peak_table_memory) {
+            peak_table_memory = workers[i].peak_memory;
+        }
+    }
+    if (has_failed()) {
+        return 1;
+    }
+
+    // Merge phase: one thread per partition
+    for (int p = 0; p < num_partitions; p++) {
+        merges[p].partition = p;
+        if (output_path) {
+            snprintf(merges[p].output_path, sizeof(merges[p].output_path),
+                     "%s.part%d", output_path, p);
+        }
+        if (pthread_create(&threads[p], NULL, merge_partition, &merges[p]) != 0) {
+            perror("Thread creation failed");
+            exit(1);
+        }
+    }
+
+    uint64_t distinct_words = 0;
+    TopEntry *candidates = checked_malloc(num_partitions * TOP_K * sizeof(TopEntry));
+    int num_candidates = 0;
+    int intermediate_runs = 0;
+    for (int p = 0; p < num_partitions; p++) {
+        pthread_join(threads[p], NULL);
+        distinct_words += merges[p].distinct_words;
+        intermediate_runs += merges[p].intermediate_runs;
+        memcpy(&candidates[num_candidates], merges[p].top, merges[p].top_size * sizeof(TopEntry));
+        num_candidates += merges[p].top_size;
+    }
+    if (has_failed()) {
+        return 1;
+    }
+    qsort(candidates, num_candidates, sizeof(TopEntry), compare_top_entries);
+
+    if (output_path) {
+        FILE *output = fopen(output_path, "w");
+        if (!output) {
+            perror("Error creating output file");
+            return 1;
+        }
+        for (int p = 0; p < num_partitions; p++) {
+            append_partition_output(output, merges[p].output_path);
+        }
+        if (fclose(output) != 0) {
+            perror("Error writing output file");
+            return 1;
+        }
+    }
+
+    // End timing execution
+    gettimeofday(&end, NULL);
+    double execution_time = (end.tv_sec - start.tv_sec) +
+                            (end.tv_usec - start.tv_usec) / 1000000.0;
+
+    // Print top frequent words
+    printf("Top 10 Most Frequent Words:\n");
+    int print_limit = (TOP_K < num_candidates) ? TOP_K : num_candidates;
+    for (int i = 0; i < print_limit; i++) {
+        printf("%s: %llu\n", candidates[i].word, (unsigned long long)candidates[i].count);
+    }
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    // Print statistics
+    printf("\nTotal Words: %llu\n", (unsigned long long)total_words);
+    printf("Distinct Words: %llu\n", (unsigned long long)distinct_words);
+    printf("Number of Workers Used: %d\n", num_workers);
+    printf("Memory Budget: %ld MB (peak table %.1f MB per worker)\n",
+           budget_mb, peak_table_memory / (1024.0 * 1024.0));
+    printf("Spilled Runs: %d\n", total_runs);
+    printf("Merge Fan-In: %d (%d intermediate runs)\n", fan_in, intermediate_runs);
+    printf("Peak RSS: %.1f MB\n", usage.ru_maxrss / 1024.0);
+    printf("Execution Time: %.4f seconds\n", execution_time);
+
+    for (int p = 0; p < num_partitions; p++) {
+        free(partition_runs[p].paths);
+    }
+    free(partition_runs);
+    free(merges);
+    partition_runs = NULL;
+    merges = NULL;
+    free(candidates);
+    free(workers);
+    free(threads);
+    return 0;
+}
@@ -0,0 +1,117 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "wordcount.h"
+
+#define TOP_K 10
+#define NUM_PROCESSES 0  // one per memory domain
+
+int main(int argc, char *argv[]) {
+    const char *filename = argc > 1 ? argv[1] : "text8.txt";  // name of input file
+    const char *counts_file = argc > 2 && argv[2][0] != '-' ? argv[2] : NULL;
+    int workers = argc > 3 ? atoi(argv[3]) : NUM_PROCESSES;
+    int autotune = argc > 4 && strcmp(argv[4], "auto") == 0;
+    int threads_per_process = argc > 4 && !autotune ? atoi(argv[4]) : 0;
+    int memory = wc_memory_flags(getenv("WORDCOUNT_MEMORY"));  // e.g. "huge,prefault"
+    const char *tune_file = argc > 5 ? argv[5] : NULL;  // keeps the tuned configuration
+
+    // Time tracking structures
+    struct timeval start, end;
+    double execution_time;
+
+    // Start timing execution
+    gettimeofday(&start, NULL);
+
+    // Read words from file
+    WordCorpus *corpus = wc_corpus_load(filename, memory);
+    if (!corpus) {
+        fprintf(stderr, "Failed to read words from file\n");
+        return 1;
+    }
+
+    // Calibrate threads per process and chunk size, or reuse an earlier calibration
+    WordCountOptions options = {WC_ENGINE_HYBRID, workers, threads_per_process, 0, memory};
+    double tune_time = 0.0;
+    // A saved calibration for another process count does not apply
+    int tuned = autotune && tune_file && wc_load_options(tune_file, WC_ENGINE_HYBRID, &options) &&
+                (workers <= 0 || options.workers == workers);
+    if (autotune && !tuned) {
+        struct timeval tune_start, tune_end;
+        gettimeofday(&tune_start, NULL);
+        options.workers = workers;  // kept by the calibration, 0 picks one per domain
+        if (!wc_autotune(corpus, WC_ENGINE_HYBRID, 0, &options, stdout)) {
+            fprintf(stderr, "Failed to auto-tune\n");
+            wc_corpus_close(corpus);
+            return 1;
+        }
+        if (tune_file) {
+            wc_save_options(tune_file, &options);
+        }
+        gettimeofday(&tune_end, NULL);
+        tune_time = (tune_end.tv_sec - tune_start.tv_sec) +
+                    (tune_end.tv_usec - tune_start.tv_usec) / 1000000.0;
+        printf("Calibration Time: %.4f seconds\n\n", tune_time);
+    }
+    options.memory = memory;  // tuned options do not carry the memory backend
+
+    // Count and sort word frequencies
+    WordCountResult *result = wc_count(corpus, &options);
+    if (!result) {
+        fprintf(stderr, "Failed to count word frequencies\n");
+        wc_corpus_close(corpus);
+        return 1;
+    }
+
+    // End timing execution, calibration is reported separately
+    gettimeofday(&end, NULL);
+    execution_time = (end.tv_sec - start.tv_sec) +
+                     (end.tv_usec - start.tv_usec) / 1000000.0 - tune_time;
+
+    // Print top frequent words
+    WordCount top[TOP_K];
+    int print_limit = wc_top_k(result, TOP_K, top);
+    printf("Top 10 Most Frequent Words:\n");
+    for (int i = 0; i < print_limit; i++) {
+        printf("%s: %d\n", top[i].word, top[i].frequency);
+    }
+
+    // Print statistics
+    const WordCountStats *stats = wc_result_stats(result);
+    printf("\nTotal Words: %d\n", stats->total_words);
+    printf("Processes x Threads Used: %d x %d (%d memory domains)\n",
+           stats->processes, stats->threads_per_process, stats->memory_domains);
+    printf("Chunks per Worker: %d\n", stats->chunks_per_worker);
+    printf("Hot Cache Hit Rate: %.2f%% (%lld flushes)\n",
+           stats->total_words ? 100.0 * stats->cache_hits / stats->total_words : 0.0,
+           stats->cache_flushes);
+    printf("Distinct Words: %d (estimated %.0f)\n", stats->distinct_words, stats->estimated_distinct);
+    printf("Memory: %s, %lld page faults, ", wc_pages_name(stats->pages), stats->page_faults);
+    if (stats->dtlb_misses >= 0) {
+        printf("%lld dTLB load misses\n", stats->dtlb_misses);
+    } else {
+        printf("dTLB load misses n/a\n");
+    }
+    printf("Peak RSS: %.1f MB (largest child %.1f MB)\n", stats->peak_rss_mb, stats->peak_child_rss_mb);
+    printf("Execution Time: %.4f seconds\n", execution_time);
+
+    // Optionally export the full ranking, in binary for a .bin file
+    if (counts_file) {
+        const char *extension = strrchr(counts_file, '.');
+        WordCountFormat format = extension && strcmp(extension, ".bin") == 0
+                               ? WC_FORMAT_BINARY : WC_FORMAT_TSV;
+        gettimeofday(&start, NULL);
+        if (wc_export_ranking(result, counts_file, format)) {
+            gettimeofday(&end, NULL);
+            printf("Export Time: %.4f seconds\n", (end.tv_sec - start.tv_sec) +
+                                                  (end.tv_usec - start.tv_usec) / 1000000.0);
+        }
+    }
+
+    // Free resources
+    wc_result_free(result);
+    wc_corpus_close(corpus);
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,535 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "wordcount.h"
+
+#define MAX_WORD_LENGTH WC_MAX_WORD_LENGTH
+#define NUM_READER_THREADS 8
+#define MAX_QUERY_K 1000
+#define LISTEN_BACKLOG 128
+#define HISTOGRAM_BUCKETS 40
+#define MAX_REQUESTS_PER_WAKEUP 64   // then let other connections have the thread
+#define WRITE_TIMEOUT_MS 5000
+
+/*
+ * Binary protocol (host byte order, one request/response pair at a time,
+ * connections stay open until the client closes them; keys must not contain
+ * NUL bytes):
+ *
+ *   request:  QueryHeader, followed by `len` bytes of word or prefix
+ *   response: ResponseHeader, followed by `count` entries of
+ *             { uint32_t frequency; uint16_t len; char word[len]; }
+ *
+ * OP_TOP_K returns the k most frequent words, OP_COUNT returns a single entry
+ * for the requested word (frequency 0 and STATUS_NOT_FOUND if absent) and
+ * OP_PREFIX_TOP_K returns the k most frequent words starting with the prefix.
+ */
+enum {
+    OP_TOP_K = 1,
+    OP_COUNT = 2,
+    OP_PREFIX_TOP_K = 3,
+    NUM_OPS
+};
+
+enum {
+    STATUS_OK = 0,
+    STATUS_NOT_FOUND = 1,
+    STATUS_BAD_REQUEST = 2
+};
+
+typedef struct {
+    uint8_t op;
+    uint8_t reserved;
+    uint16_t k;
+    uint16_t len;
+} QueryHeader;
+
+typedef struct {
+    uint32_t status;
+    uint32_t count;
+} ResponseHeader;
+
+// A client connection and its partially received request. Connections are
+// registered with EPOLLONESHOT, so one reader thread at a time owns one.
+typedef struct {
+    int fd;
+    size_t used;
+    char input[sizeof(QueryHeader) + MAX_WORD_LENGTH];
+} Connection;
+
+// Resident, read-only frequency table shared by all reader threads
+typedef struct {
+    WordCountResult *result;  // counts, answers single-word lookups
+    WordCount *ranked;        // sorted by frequency, descending
+    int size;
+    int *lexical;             // ranks sorted by word, used for prefix queries
+} FreqTable;
+
+// Per-query-type latency histogram, bucket b counts latencies in [2^b, 2^(b+1)) ns
+typedef struct {
+    uint64_t buckets[HISTOGRAM_BUCKETS];
+    uint64_t count;
+    uint64_t total_ns;
+    uint64_t max_ns;
+} LatencyHistogram;
+
+static FreqTable table;
+static LatencyHistogram histograms[NUM_OPS];
+static const char *op_names[NUM_OPS] = {"", "top-k", "count", "prefix-top-k"};
+
+// Order ranks by the word they refer to
+int compare_by_word(const void *a, const void *b) {
+    return strcmp(table.ranked[*(const int*)a].word, table.ranked[*(const int*)b].word);
+}
+
+// Count the corpus with the library and build the prefix index over its
+// ranking. The corpus is dropped once counted, the result stays resident.
+int load_freq_table(const char *filename) {
+    WordCorpus *corpus = wc_corpus_open(filename);
+    if (!corpus) {
+        return 0;
+    }
+    WordCountOptions options = {WC_ENGINE_INDEXED, 1, 0, 0, 0};
+    table.result = wc_count(corpus, &options);
+    int total_words = wc_corpus_size(corpus);
+    wc_corpus_close(corpus);
+    if (!table.result) {
+        return 0;
+    }
+
+    table.size = wc_result_size(table.result);
+    table.ranked = malloc((table.size > 0 ? table.size : 1) * sizeof(WordCount));
+    if (!table.ranked) {
+        perror("Memory allocation failed");
+        exit(1);
+    }
+    wc_top_k(table.result, table.size, table.ranked);
+
+    table.lexical = malloc((table.size > 0 ? table.size : 1) * sizeof(int));
+    if (!table.lexical) {
+        perror("Memory allocation failed");
+        exit(1);
+    }
+    for (int i = 0; i < table.size; i++) {
+        table.lexical[i] = i;
+    }
+    qsort(table.lexical, table.size, sizeof(int), compare_by_word);
+
+    printf("Loaded %d words, %d distinct, from %s\n", total_words, table.size, filename);
+    return 1;
+}
+
+// Collect the k best ranks among words starting with `prefix`, best first
+int prefix_top_k(const char *prefix, size_t len, int k, int *out) {
+    // Lower bound of the prefix in lexical order
+    int lo = 0, hi = table.size;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (strncmp(table.ranked[table.lexical[mid]].word, prefix, len) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    // Keep the k smallest ranks in a max-heap while scanning the prefix range
+    int n = 0;
+    for (int i = lo; i < table.size; i++) {
+        int rank = table.lexical[i];
+        if (strncmp(table.ranked[rank].word, prefix, len) != 0) {
+            break;
+        }
+        if (n < k) {
+            int c = n++;
+            while (c > 0 && out[(c - 1) / 2] < rank) {
+                out[c] = out[(c - 1) / 2];
+                c = (c - 1) / 2;
+            }
+            out[c] = rank;
+        } else if (rank < out[0]) {
+            int c = 0;
+            for (;;) {
+                int child = 2 * c + 1;
+                if (child >= n) break;
+                if (child + 1 < n && out[child + 1] > out[child]) child++;
+                if (out[child] <= rank) break;
+                out[c] = out[child];
+                c = child;
+            }
+            out[c] = rank;
+        }
+    }
+
+    // Heap sort in place, leaving ranks ascending
+    for (int end = n - 1; end > 0; end--) {
+        int top = out[0];
+        int last = out[end];
+        int c = 0;
+        for (;;) {
+            int child = 2 * c + 1;
+            if (child >= end) break;
+            if (child + 1 < end && out[child + 1] > out[child]) child++;
+            if (out[child] <= last) break;
+            out[c] = out[child];
+            c = child;
+        }
+        out[c] = last;
+        out[end] = top;
+    }
+    return n;
+}
+
+// Append one response entry to the output buffer
+size_t put_entry(char *buffer, size_t offset, const char *word, size_t len, uint32_t frequency) {
+    uint16_t word_len = (uint16_t)len;
+    memcpy(buffer + offset, &frequency, sizeof(frequency));
+    offset += sizeof(frequency);
+    memcpy(buffer + offset, &word_len, sizeof(word_len));
+    offset += sizeof(word_len);
+    memcpy(buffer + offset, word, len);
+    return offset + len;
+}
+
+// Answer a single query into `buffer`, returning the response length
+size_t answer_query(const QueryHeader *query, const char *key, char *buffer, int *ranks) {
+    ResponseHeader header = {STATUS_OK, 0};
+    size_t offset = sizeof(header);
+    int k = query->k < MAX_QUERY_K ? query->k : MAX_QUERY_K;
+
+    switch (query->op) {
+    case OP_TOP_K: {
+        int limit = k < table.size ? k : table.size;
+        for (int i = 0; i < limit; i++) {
+            const WordCount *entry = &table.ranked[i];
+            offset = put_entry(buffer, offset, entry->word, strlen(entry->word), entry->frequency);
+        }
+        header.count = limit;
+        break;
+    }
+    case OP_COUNT: {
+        uint32_t frequency = (uint32_t)wc_lookup(table.result, key);
+        if (!frequency) {
+            header.status = STATUS_NOT_FOUND;
+        }
+        offset = put_entry(buffer, offset, key, query->len, frequency);
+        header.count = 1;
+        break;
+    }
+    case OP_PREFIX_TOP_K: {
+        int n = prefix_top_k(key, query->len, k, ranks);
+        for (int i = 0; i < n; i++) {
+            const WordCount *entry = &table.ranked[ranks[i]];
+            offset = put_entry(buffer, offset, entry->word, strlen(entry->word), entry->frequency);
+        }
+        header.count = n;
+        break;
+    }
+    default:
+        header.status = STATUS_BAD_REQUEST;
+        break;
+    }
+
+    memcpy(buffer, &header, sizeof(header));
+    return offset;
+}
+
+// Write exactly `len` bytes to a non-blocking socket, waiting for room while
+// the client drains it; returns 0 on error or a client that stopped reading
+int write_full(int fd, const void *buf, size_t len) {
+    const char *p = buf;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            struct pollfd writable = {fd, POLLOUT, 0};
+            if (poll(&writable, 1, WRITE_TIMEOUT_MS) <= 0) return 0;
+            continue;
+        }
+        if (n <= 0) return 0;
+        p += n;
+        len -= n;
+    }
+    return 1;
+}
+
+uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Record one latency sample; counters are shared by all reader threads
+void record_latency(int op, uint64_t ns) {
+    LatencyHistogram *h = &histograms[op];
+    int bucket = 0;
+    while (bucket < HISTOGRAM_BUCKETS - 1 && (ns >> (bucket + 1)) != 0) {
+        bucket++;
+    }
+    __atomic_fetch_add(&h->buckets[bucket], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->total_ns, ns, __ATOMIC_RELAXED);
+
+    uint64_t max = __atomic_load_n(&h->max_ns, __ATOMIC_RELAXED);
+    while (ns > max &&
+           !__atomic_compare_exchange_n(&h->max_ns, &max, ns, 1,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+// Upper bound of the bucket containing the given percentile
+uint64_t histogram_percentile(const LatencyHistogram *h, uint64_t count, double percentile) {
+    uint64_t target = (uint64_t)(count * percentile);
+    uint64_t seen = 0;
+    for (int b = 0; b < HISTOGRAM_BUCKETS; b++) {
+        seen += __atomic_load_n(&h->buckets[b], __ATOMIC_RELAXED);
+        if (seen > target) {
+            return 1ULL << (b + 1);
+        }
+    }
+    return 1ULL << HISTOGRAM_BUCKETS;
+}
+
+void print_histograms(void) {
+    printf("\nQuery latency (ns, bucket upper bounds):\n");
+    for (int op = 1; op < NUM_OPS; op++) {
+        const LatencyHistogram *h = &histograms[op];
+        uint64_t count = __atomic_load_n(&h->count, __ATOMIC_RELAXED);
+        if (count == 0) {
+            printf("%-13s no queries\n", op_names[op]);
+            continue;
+        }
+        printf("%-13s n=%llu mean=%llu p50<=%llu p90<=%llu p99<=%llu max=%llu\n",
+               op_names[op], (unsigned long long)count,
+               (unsigned long long)(__atomic_load_n(&h->total_ns, __ATOMIC_RELAXED) / count),
+               (unsigned long long)histogram_percentile(h, count, 0.50),
+               (unsigned long long)histogram_percentile(h, count, 0.90),
+               (unsigned long long)histogram_percentile(h, count, 0.99),
+               (unsigned long long)__atomic_load_n(&h->max_ns, __ATOMIC_RELAXED));
+    }
+    fflush(stdout);
+}
+
+// Answer every complete request buffered on a connection, returns 0 once
+// the connection should be closed
+int answer_pending(Connection *conn, char *buffer, int *ranks) {
+    while (conn->used >= sizeof(QueryHeader)) {
+        QueryHeader query;
+        memcpy(&query, conn->input, sizeof(query));
+        if (query.len >= MAX_WORD_LENGTH) {
+            ResponseHeader header = {STATUS_BAD_REQUEST, 0};
+            write_full(conn->fd, &header, sizeof(header));
+            return 0;
+        }
+        size_t request_len = sizeof(query) + query.len;
+        if (conn->used < request_len) {
+            break;
+        }
+
+        char key[MAX_WORD_LENGTH];
+        memcpy(key, conn->input + sizeof(query), query.len);
+        key[query.len] = '\0';
+
+        size_t len;
+        if (memchr(key, '\0', query.len)) {
+            // An embedded NUL would make the key ambiguous
+            ResponseHeader header = {STATUS_BAD_REQUEST, 0};
+            memcpy(buffer, &header, sizeof(header));
+            len = sizeof(header);
+        } else {
+            uint64_t start = now_ns();
+            len = answer_query(&query, key, buffer, ranks);
+            if (query.op > 0 && query.op < NUM_OPS) {
+                record_latency(query.op, now_ns() - start);
+            }
+        }
+        if (!write_full(conn->fd, buffer, len)) {
+            return 0;
+        }
+
+        conn->used -= request_len;
+        memmove(conn->input, conn->input + request_len, conn->used);
+    }
+    return 1;
+}
+
+// Read and answer what a readable connection has sent, without waiting for
+// more; returns 0 once the client hung up or the connection failed
+int serve_connection(Connection *conn, char *buffer, int *ranks) {
+    for (int reads = 0; reads < MAX_REQUESTS_PER_WAKEUP; reads++) {
+        ssize_t n = read(conn->fd, conn->input + conn->used, sizeof(conn->input) - conn->used);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return 1;
+        if (n <= 0) return 0;
+        conn->used += n;
+        if (!answer_pending(conn, buffer, ranks)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Accept every pending connection and watch it for requests
+void accept_connections(int listen_fd, int epoll_fd) {
+    for (;;) {
+        int fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            return;
+        }
+        Connection *conn = malloc(sizeof(Connection));
+        if (!conn) {
+            perror("Memory allocation failed");
+            close(fd);
+            continue;
+        }
+        conn->fd = fd;
+        conn->used = 0;
+        struct epoll_event event = {EPOLLIN | EPOLLONESHOT, {.ptr = conn}};
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+            perror("epoll_ctl failed");
+            close(fd);
+            free(conn);
+        }
+    }
+}
+
+// Reader thread: wait on the shared epoll set and serve whichever connection
+// is ready, so a thread is never tied to one client for its lifetime
+void* reader_thread(void *arg) {
+    int *fds = (int*)arg;
+    int listen_fd = fds[0];
+    int epoll_fd = fds[1];
+    size_t buffer_size = sizeof(ResponseHeader) +
+                         MAX_QUERY_K * (sizeof(uint32_t) + sizeof(uint16_t) + MAX_WORD_LENGTH);
+    char *buffer = malloc(buffer_size);
+    int *ranks = malloc(MAX_QUERY_K * sizeof(int));
+    if (!buffer || !ranks) {
+        perror("Memory allocation failed");
+        exit(1);
+    }
+
+    for (;;) {
+        struct epoll_event event;
+        int n = epoll_wait(epoll_fd, &event, 1, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        // The listening socket is registered with a NULL connection
+        Connection *conn = event.data.ptr;
+        if (!conn) {
+            accept_connections(listen_fd, epoll_fd);
+            struct epoll_event rearm = {EPOLLIN | EPOLLONESHOT, {.ptr = NULL}};
+            epoll_ctl(epoll_fd, EPOLL_CTL_MOD, listen_fd, &rearm);
+            continue;
+        }
+
+        // A hang-up or error shows up as a failed read
+        if (serve_connection(conn, buffer, ranks)) {
+            struct epoll_event rearm = {EPOLLIN | EPOLLONESHOT, {.ptr = conn}};
+            if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, conn->fd, &rearm) == 0) {
+                continue;
+            }
+        }
+        close(conn->fd);
+        free(conn);
+    }
+
+    free(buffer);
+    free(ranks);
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    const char *filename = argc > 1 ? argv[1] : "text8.txt";
+    const char *socket_path = argc > 2 ? argv[2] : "/tmp/wordfreq.sock";
+    int num_threads = argc > 3 ? atoi(argv[3]) : NUM_READER_THREADS;
+    if (num_threads < 1) {
+        num_threads = 1;
+    }
+
+    if (!load_freq_table(filename)) {
+        fprintf(stderr, "Failed to read words from file\n");
+        return 1;
+    }
+
+    // Block signals in every thread; main handles them with sigwait
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0) {
+        perror("socket failed");
+        return 1;
+    }
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
+    unlink(socket_path);
+
+    if (bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+        listen(listen_fd, LISTEN_BACKLOG) < 0) {
+        perror("bind/listen failed");
+        close(listen_fd);
+        return 1;
+    }
+
+    // Every reader thread waits on one epoll set holding the listening socket
+    // and all client connections
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event listen_event = {EPOLLIN | EPOLLONESHOT, {.ptr = NULL}};
+    if (epoll_fd < 0 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &listen_event) < 0) {
+        perror("epoll setup failed");
+        close(listen_fd);
+        unlink(socket_path);
+        return 1;
+    }
+    int fds[2] = {listen_fd, epoll_fd};
+
+    pthread_t *threads = malloc(num_threads * sizeof(pthread_t));
+    for (int i = 0; i < num_threads; i++) {
+        if (pthread_create(&threads[i], NULL, reader_thread, fds) != 0) {
+            perror("Thread creation failed");
+            unlink(socket_path);
+            return 1;
+        }
+    }
+
+    printf("Serving on %s with %d reader threads\n", socket_path, num_threads);
+    fflush(stdout);
+
+    // SIGUSR1 dumps the histograms, SIGINT/SIGTERM dump them and exit
+    for (;;) {
+        int sig;
+        sigwait(&signals, &sig);
+        print_histograms();
+        if (sig != SIGUSR1) {
+            break;
+        }
+    }
+
+    close(listen_fd);
+    unlink(socket_path);
+    return 0;
+}
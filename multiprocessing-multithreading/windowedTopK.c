@@ -0,0 +1,587 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <math.h>
+#include <time.h>
+
+#define MAX_WORD_LENGTH 60
+#define TOP_K 10
+#define GROWTH_FACTOR 2
+#define INITIAL_VOCABULARY 65536
+#define DEFAULT_REPORT_EVERY 100000
+#define MAX_DECAY_EXPONENT 500.0
+#define MIN_DECAY_SCORE 1e-9        // decayed weight below which a word is forgotten
+
+/*
+ * Windowed word counting over a token stream read from stdin or a file.
+ *
+ *   tumbling N   counts restart every N tokens (or every N seconds with "Ns")
+ *   sliding N    counts cover the last N tokens (or the last N seconds)
+ *   decay N      every occurrence is weighted by 2^(-age / N), N in tokens or seconds
+ *
+ * Window modes keep exact counts in a stream-summary structure: words with
+ * the same count share a bucket and buckets form a list ordered by count, so
+ * a token entering or leaving the window moves one word to a neighbouring
+ * bucket in O(1) and the top-K is read from the highest buckets. A word whose
+ * count drops back to 0 is evicted and its id recycled, so memory follows the
+ * words inside the window rather than every word ever seen.
+ *
+ * Decay mode uses forward decay: an occurrence at time t adds e^(lambda * t)
+ * to its word's score, so scores only ever grow and a min-heap of the K best
+ * words stays exact under updates. Scores are rescaled before they overflow,
+ * and words outside the heap whose rescaled score has decayed to almost
+ * nothing are evicted then, so memory follows the recently active words.
+ */
+
+typedef enum {
+    MODE_TUMBLING,
+    MODE_SLIDING,
+    MODE_DECAY
+} WindowMode;
+
+// Group of words sharing the same count, linked in ascending count order
+typedef struct Bucket {
+    int count;
+    int head;                  // first word id in this bucket, -1 if none
+    struct Bucket *prev;
+    struct Bucket *next;
+} Bucket;
+
+// Per-word state, indexed by word id
+typedef struct {
+    char *word;                // NULL once the id is recycled
+    uint64_t hash;
+    int count;
+    double score;              // decay mode only
+    Bucket *bucket;            // window modes only, NULL when count is 0
+    int prev;                  // neighbours inside the bucket
+    int next;                  // or the next free id once recycled
+    int heap_pos;              // decay mode only, -1 when not in the heap
+} WordState;
+
+// Interned vocabulary: hash index from word to id plus per-id state
+typedef struct {
+    WordState *words;
+    int size;
+    int capacity;
+    int *slots;                // id + 1, 0 marks an empty slot
+    size_t mask;
+    int free_head;             // first recycled id, -1 if none
+    int resident;              // ids currently holding a word
+} Vocabulary;
+
+// One token inside a sliding window
+typedef struct {
+    int id;
+    double time;
+} WindowEntry;
+
+// Ring buffer holding the tokens currently inside a sliding window
+typedef struct {
+    WindowEntry *data;
+    int head;
+    int size;
+    int capacity;
+} WindowQueue;
+
+static Vocabulary vocab;
+static Bucket *lowest_bucket;
+static Bucket *highest_bucket;
+static Bucket *free_buckets;
+
+static int *heap;
+static int heap_size;
+static int heap_capacity = TOP_K;
+static double lambda;
+static double landmark;
+
+// FNV-1a hash of a word
+static uint64_t hash_word(const char *word) {
+    uint64_t h = 1469598103934665603ULL;
+    while (*word) {
+        h ^= (unsigned char)*word++;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+void* checked_realloc(void *ptr, size_t size) {
+    void *result = realloc(ptr, size);
+    if (!result) {
+        perror("Memory reallocation failed");
+        exit(1);
+    }
+    return result;
+}
+
+// Find the slot holding `word`, or the empty slot where it belongs
+size_t find_slot(const char *word, uint64_t hash) {
+    size_t slot = hash & vocab.mask;
+    while (vocab.slots[slot] != 0 &&
+           strcmp(vocab.words[vocab.slots[slot] - 1].word, word) != 0) {
+        slot = (slot + 1) & vocab.mask;
+    }
+    return slot;
+}
+
+void init_vocabulary(void) {
+    vocab.capacity = INITIAL_VOCABULARY;
+    vocab.size = 0;
+    vocab.free_head = -1;
+    vocab.resident = 0;
+    vocab.words = checked_realloc(NULL, vocab.capacity * sizeof(WordState));
+    vocab.mask = (size_t)vocab.capacity * 2 - 1;
+    vocab.slots = calloc(vocab.mask + 1, sizeof(int));
+    if (!vocab.slots) {
+        perror("Memory allocation failed");
+        exit(1);
+    }
+}
+
+// Return the id of `word`, interning it on first sight
+int intern_word(const char *word) {
+    uint64_t hash = hash_word(word);
+    size_t slot = find_slot(word, hash);
+    if (vocab.slots[slot] != 0) {
+        return vocab.slots[slot] - 1;
+    }
+
+    // Reuse a recycled id before growing
+    int id;
+    if (vocab.free_head >= 0) {
+        id = vocab.free_head;
+        vocab.free_head = vocab.words[id].next;
+    } else if (vocab.size < vocab.capacity) {
+        id = vocab.size++;
+    } else {
+        vocab.capacity *= GROWTH_FACTOR;
+        vocab.words = checked_realloc(vocab.words, vocab.capacity * sizeof(WordState));
+
+        // Rebuild the hash index at the new size
+        free(vocab.slots);
+        vocab.mask = (size_t)vocab.capacity * 2 - 1;
+        vocab.slots = calloc(vocab.mask + 1, sizeof(int));
+        if (!vocab.slots) {
+            perror("Memory allocation failed");
+            exit(1);
+        }
+        // No id is free when growing, so every id holds a word
+        for (int i = 0; i < vocab.size; i++) {
+            vocab.slots[find_slot(vocab.words[i].word, vocab.words[i].hash)] = i + 1;
+        }
+        slot = find_slot(word, hash);
+        id = vocab.size++;
+    }
+
+    WordState *state = &vocab.words[id];
+    state->word = strdup(word);
+    if (!state->word) {
+        perror("Memory allocation failed");
+        exit(1);
+    }
+    state->hash = hash;
+    state->count = 0;
+    state->score = 0.0;
+    state->bucket = NULL;
+    state->prev = state->next = -1;
+    state->heap_pos = -1;
+    vocab.slots[slot] = id + 1;
+    vocab.resident++;
+    return id;
+}
+
+// Evict a word whose count dropped to 0 and recycle its id. The hash slot
+// is emptied with backward-shift deletion so linear probing stays intact.
+void release_word(int id) {
+    WordState *state = &vocab.words[id];
+    size_t hole = find_slot(state->word, state->hash);
+    vocab.slots[hole] = 0;
+    for (size_t next = (hole + 1) & vocab.mask; vocab.slots[next] != 0;
+         next = (next + 1) & vocab.mask) {
+        size_t home = vocab.words[vocab.slots[next] - 1].hash & vocab.mask;
+        // Move the entry back unless its home lies between the hole and it
+        if (((next - home) & vocab.mask) >= ((next - hole) & vocab.mask)) {
+            vocab.slots[hole] = vocab.slots[next];
+            vocab.slots[next] = 0;
+            hole = next;
+        }
+    }
+
+    free(state->word);
+    state->word = NULL;
+    state->next = vocab.free_head;
+    vocab.free_head = id;
+    vocab.resident--;
+}
+
+// Take a bucket from the free list or allocate a new one
+Bucket* new_bucket(int count) {
+    Bucket *bucket = free_buckets;
+    if (bucket) {
+        free_buckets = bucket->next;
+    } else {
+        bucket = malloc(sizeof(Bucket));
+        if (!bucket) {
+            perror("Memory allocation failed");
+            exit(1);
+        }
+    }
+    bucket->count = count;
+    bucket->head = -1;
+    bucket->prev = bucket->next = NULL;
+    return bucket;
+}
+
+// Unlink an empty bucket from the bucket list and recycle it
+void release_bucket(Bucket *bucket) {
+    if (bucket->prev) bucket->prev->next = bucket->next; else lowest_bucket = bucket->next;
+    if (bucket->next) bucket->next->prev = bucket->prev; else highest_bucket = bucket->prev;
+    bucket->next = free_buckets;
+    free_buckets = bucket;
+}
+
+// Insert a new bucket right after `after` (or first when `after` is NULL)
+Bucket* insert_bucket_after(Bucket *after, int count) {
+    Bucket *bucket = new_bucket(count);
+    bucket->prev = after;
+    bucket->next = after ? after->next : lowest_bucket;
+    if (bucket->next) bucket->next->prev = bucket; else highest_bucket = bucket;
+    if (after) after->next = bucket; else lowest_bucket = bucket;
+    return bucket;
+}
+
+void attach_word(Bucket *bucket, int id) {
+    WordState *state = &vocab.words[id];
+    state->bucket = bucket;
+    state->prev = -1;
+    state->next = bucket->head;
+    if (bucket->head >= 0) vocab.words[bucket->head].prev = id;
+    bucket->head = id;
+}
+
+void detach_word(int id) {
+    WordState *state = &vocab.words[id];
+    if (state->prev >= 0) vocab.words[state->prev].next = state->next;
+    else state->bucket->head = state->next;
+    if (state->next >= 0) vocab.words[state->next].prev = state->prev;
+    state->bucket = NULL;
+}
+
+// A token of word `id` entered the window
+void increment_word(int id) {
+    WordState *state = &vocab.words[id];
+    Bucket *current = state->bucket;
+    int count = ++state->count;
+
+    Bucket *target = current ? current->next : lowest_bucket;
+    if (!target || target->count != count) {
+        target = insert_bucket_after(current, count);
+    }
+
+    if (current) {
+        detach_word(id);
+        if (current->head < 0) release_bucket(current);
+    }
+    attach_word(target, id);
+}
+
+// A token of word `id` left the window
+void decrement_word(int id) {
+    WordState *state = &vocab.words[id];
+    Bucket *current = state->bucket;
+    int count = --state->count;
+
+    Bucket *target = NULL;
+    if (count > 0) {
+        target = current->prev;
+        if (!target || target->count != count) {
+            target = insert_bucket_after(current->prev, count);
+        }
+    }
+
+    detach_word(id);
+    if (current->head < 0) release_bucket(current);
+    if (target) {
+        attach_word(target, id);
+    } else {
+        release_word(id);
+    }
+}
+
+// Drop every count at a tumbling window boundary, evicting every word
+void reset_counts(void) {
+    while (highest_bucket) {
+        Bucket *bucket = highest_bucket;
+        for (int id = bucket->head; id >= 0; ) {
+            int next = vocab.words[id].next;
+            vocab.words[id].count = 0;
+            vocab.words[id].bucket = NULL;
+            release_word(id);
+            id = next;
+        }
+        bucket->head = -1;
+        release_bucket(bucket);
+    }
+}
+
+void print_window_top_k(const char *label, long long position, int k) {
+    printf("Top %d words %s %lld:\n", k, label, position);
+    int printed = 0;
+    for (Bucket *bucket = highest_bucket; bucket && printed < k; bucket = bucket->prev) {
+        for (int id = bucket->head; id >= 0 && printed < k; id = vocab.words[id].next) {
+            printf("%s: %d\n", vocab.words[id].word, bucket->count);
+            printed++;
+        }
+    }
+    printf("\n");
+}
+
+void heap_swap(int a, int b) {
+    int tmp = heap[a];
+    heap[a] = heap[b];
+    heap[b] = tmp;
+    vocab.words[heap[a]].heap_pos = a;
+    vocab.words[heap[b]].heap_pos = b;
+}
+
+// Restore the min-heap below `pos` after its score grew
+void heap_sift_down(int pos) {
+    for (;;) {
+        int smallest = pos;
+        int left = 2 * pos + 1;
+        int right = left + 1;
+        if (left < heap_size && vocab.words[heap[left]].score < vocab.words[heap[smallest]].score)
+            smallest = left;
+        if (right < heap_size && vocab.words[heap[right]].score < vocab.words[heap[smallest]].score)
+            smallest = right;
+        if (smallest == pos) return;
+        heap_swap(pos, smallest);
+        pos = smallest;
+    }
+}
+
+void heap_sift_up(int pos) {
+    while (pos > 0) {
+        int parent = (pos - 1) / 2;
+        if (vocab.words[heap[parent]].score <= vocab.words[heap[pos]].score) return;
+        heap_swap(pos, parent);
+        pos = parent;
+    }
+}
+
+// Scale every score down so the forward-decay landmark moves to `now`, and
+// evict the words outside the heap that have decayed away, except `keep`
+void rescale_scores(double now, int keep) {
+    double factor = exp(-lambda * (now - landmark));
+    for (int i = 0; i < vocab.size; i++) {
+        WordState *state = &vocab.words[i];
+        if (!state->word) continue;
+        state->score *= factor;
+        if (state->score < MIN_DECAY_SCORE && state->heap_pos < 0 && i != keep) {
+            release_word(i);
+        }
+    }
+    landmark = now;
+}
+
+// Add one decayed occurrence of word `id` observed at time `now`
+void decay_update(int id, double now) {
+    if (lambda * (now - landmark) > MAX_DECAY_EXPONENT) {
+        rescale_scores(now, id);
+    }
+
+    WordState *state = &vocab.words[id];
+    state->score += exp(lambda * (now - landmark));
+    state->count++;
+
+    if (state->heap_pos >= 0) {
+        heap_sift_down(state->heap_pos);
+    } else if (heap_size < heap_capacity) {
+        heap[heap_size] = id;
+        state->heap_pos = heap_size++;
+        heap_sift_up(state->heap_pos);
+    } else if (state->score > vocab.words[heap[0]].score) {
+        vocab.words[heap[0]].heap_pos = -1;
+        heap[0] = id;
+        state->heap_pos = 0;
+        heap_sift_down(0);
+    }
+}
+
+int compare_heap_entries(const void *a, const void *b) {
+    double x = vocab.words[*(const int*)a].score;
+    double y = vocab.words[*(const int*)b].score;
+    return (x < y) - (x > y);
+}
+
+void print_decay_top_k(long long position, double now) {
+    int *order = checked_realloc(NULL, (heap_size > 0 ? heap_size : 1) * sizeof(int));
+    memcpy(order, heap, heap_size * sizeof(int));
+    qsort(order, heap_size, sizeof(int), compare_heap_entries);
+
+    double scale = exp(-lambda * (now - landmark));
+    printf("Top %d decayed words at token %lld:\n", heap_size, position);
+    for (int i = 0; i < heap_size; i++) {
+        printf("%s: %.2f\n", vocab.words[order[i]].word, vocab.words[order[i]].score * scale);
+    }
+    printf("\n");
+    free(order);
+}
+
+double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void window_push(WindowQueue *queue, int id, double time) {
+    if (queue->size >= queue->capacity) {
+        int new_capacity = queue->capacity * GROWTH_FACTOR;
+        WindowEntry *data = checked_realloc(NULL, new_capacity * sizeof(WindowEntry));
+        for (int i = 0; i < queue->size; i++) {
+            data[i] = queue->data[(queue->head + i) % queue->capacity];
+        }
+        free(queue->data);
+        queue->data = data;
+        queue->head = 0;
+        queue->capacity = new_capacity;
+    }
+    WindowEntry *entry = &queue->data[(queue->head + queue->size) % queue->capacity];
+    entry->id = id;
+    entry->time = time;
+    queue->size++;
+}
+
+WindowEntry window_pop(WindowQueue *queue) {
+    WindowEntry entry = queue->data[queue->head];
+    queue->head = (queue->head + 1) % queue->capacity;
+    queue->size--;
+    return entry;
+}
+
+void print_usage(const char *program) {
+    fprintf(stderr, "Usage: %s tumbling|sliding|decay N[s] [k] [report_every] [file]\n"
+                    "  N is a token count, or seconds when suffixed with 's';\n"
+                    "  for decay it is the half-life.\n", program);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    WindowMode mode;
+    if (strcmp(argv[1], "tumbling") == 0) mode = MODE_TUMBLING;
+    else if (strcmp(argv[1], "sliding") == 0) mode = MODE_SLIDING;
+    else if (strcmp(argv[1], "decay") == 0) mode = MODE_DECAY;
+    else {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    char *unit;
+    double window = strtod(argv[2], &unit);
+    int by_time = (*unit == 's');
+    int k = argc > 3 ? atoi(argv[3]) : TOP_K;
+    long long report_every = argc > 4 ? atoll(argv[4]) : DEFAULT_REPORT_EVERY;
+    // A token window must hold at least one whole token, and no more than
+    // the ring buffer can index
+    if (window <= 0 ||
+        (mode != MODE_DECAY && !by_time && (window < 1 || window > INT_MAX || window != floor(window))) ||
+        k <= 0 || report_every <= 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    FILE *input = stdin;
+    if (argc > 5) {
+        input = fopen(argv[5], "r");
+        if (!input) {
+            perror("Error opening file");
+            return 1;
+        }
+    }
+
+    init_vocabulary();
+    heap_capacity = k;
+    heap = checked_realloc(NULL, heap_capacity * sizeof(int));
+    lambda = log(2.0) / window;
+
+    WindowQueue queue = {NULL, 0, 0, 0};
+    if (mode == MODE_SLIDING) {
+        queue.capacity = by_time ? INITIAL_VOCABULARY : (int)window;
+        queue.data = checked_realloc(NULL, queue.capacity * sizeof(WindowEntry));
+    }
+
+    char buffer[MAX_WORD_LENGTH];
+    long long tokens = 0;
+    double start = now_seconds();
+    double window_start = 0.0;
+    landmark = 0.0;
+
+    int peak_resident = 0;
+    while (fscanf(input, "%59s", buffer) == 1) {
+        double now = by_time ? now_seconds() - start : (double)tokens;
+        tokens++;
+
+        // Evict before interning, so the incoming word is never recycled
+        // out from under its own id
+        int id;
+        switch (mode) {
+        case MODE_TUMBLING:
+            // Close the current window before counting a token that falls past it
+            if (by_time ? now - window_start >= window : tokens > 1 && (tokens - 1) % (long long)window == 0) {
+                print_window_top_k("in window ending before token", tokens, k);
+                reset_counts();
+                window_start = now;
+            }
+            increment_word(intern_word(buffer));
+            break;
+
+        case MODE_SLIDING:
+            if (by_time) {
+                while (queue.size > 0 && queue.data[queue.head].time <= now - window) {
+                    decrement_word(window_pop(&queue).id);
+                }
+            } else if (queue.size == queue.capacity) {
+                decrement_word(window_pop(&queue).id);
+            }
+            id = intern_word(buffer);
+            window_push(&queue, id, now);
+            increment_word(id);
+            if (tokens % report_every == 0) {
+                print_window_top_k("in sliding window at token", tokens, k);
+            }
+            break;
+
+        case MODE_DECAY:
+            decay_update(intern_word(buffer), now);
+            if (tokens % report_every == 0) {
+                print_decay_top_k(tokens, now);
+            }
+            break;
+        }
+        if (vocab.resident > peak_resident) {
+            peak_resident = vocab.resident;
+        }
+    }
+
+    // Report whatever is left at end of stream
+    if (mode == MODE_DECAY) {
+        print_decay_top_k(tokens, by_time ? now_seconds() - start : (double)tokens);
+    } else {
+        print_window_top_k("at end of stream, token", tokens, k);
+    }
+
+    printf("Total Words: %lld\n", tokens);
+    printf("Resident Words: %d (peak %d)\n", vocab.resident, peak_resident);
+    printf("Execution Time: %.4f seconds\n", now_seconds() - start);
+
+    if (input != stdin) {
+        fclose(input);
+    }
+    return 0;
+}
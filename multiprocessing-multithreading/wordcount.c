@@ -0,0 +1,1928 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <unistd.h>
+#include <sched.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/wait.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include <time.h>
+
+#include "wordcount.h"
+
+#define MAX_WORD_LENGTH WC_MAX_WORD_LENGTH
+#define INITIAL_CAPACITY 18000000
+#define GROWTH_FACTOR 2
+#define DEFAULT_WORKERS 8
+#define MAX_PROCESSES 64
+#define MAX_THREADS 256
+#define HOT_CACHE_SLOTS 256
+#define HOT_CACHE_KEY_LENGTH 16
+#define HOT_CACHE_MAX_SCORE 15
+#define HOT_CACHE_FLUSH_INTERVAL 65536
+#define HLL_PRECISION 14
+#define HLL_REGISTERS (1 << HLL_PRECISION)
+#define TABLE_HEADROOM 1.25
+#define MIN_TABLE_CAPACITY 1024
+#define TUNE_SAMPLE_WORDS 50000
+#define TUNE_SAMPLE_SPANS 16
+#define TUNE_REPEATS 2
+#define HUGE_PAGE_SIZE ((size_t)2 << 20)
+#define BASE_PAGE_SIZE 4096
+#define MAPPED_MIN_SIZE HUGE_PAGE_SIZE          // smaller buffers stay on the heap
+#define PREFAULT_MAX_THREADS 64
+#define CORPUS_BLOCK_SIZE ((size_t)64 << 20)
+#define MIN_CORPUS_BLOCK_SIZE ((size_t)64 << 10)
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+#define RANK_PARALLEL_MIN 65536                 // smaller tables are ranked by one thread
+#define EXPORT_BUFFER_SIZE (1 << 20)
+#define RANKING_MAGIC "WCRANK1\n"
+
+// Word frequency structure, the word is stored inline so tables can live in
+// shared memory
+typedef struct {
+    char word[MAX_WORD_LENGTH];
+    int frequency;
+    int first;                          // position of the first occurrence, breaks ranking ties
+} WordFreq;
+
+// Dynamic array for word frequencies
+typedef struct {
+    WordFreq *data;
+    int size;
+    int capacity;
+    int memory;                         // WC_MEMORY_* flags for the buffer
+} WordFreqArray;
+
+// Header in front of every buffer from the memory backend
+typedef struct {
+    size_t mapped;                      // bytes mapped including the header, 0 on the heap
+    int pages;                          // WordCountPages
+    int padding;
+} BufferHeader;
+
+// Holds the threads of a pool until all of them exist, so a failed
+// pthread_create can call the pool off before anyone waits on a barrier
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    int state;                          // 0 closed, 1 open, -1 called off
+} StartGate;
+
+// Sort key and table position of one word during ranking
+typedef struct {
+    uint64_t key;
+    int index;
+} RankEntry;
+
+// State shared by the ranking threads
+typedef struct {
+    const WordFreq *data;
+    int size;
+    int num_threads;
+    RankEntry *entries;
+    RankEntry *scratch;
+    size_t *histograms;                 // RADIX_BUCKETS per thread
+    uint64_t *differing;                // key bits that vary, per thread
+    WordFreq *ranked;
+    pthread_barrier_t *barrier;
+    StartGate *gate;
+} RankingJob;
+
+typedef struct {
+    RankingJob *job;
+    int thread_id;
+} RankWorkerArgs;
+
+// Output buffered in large blocks for the ranking export
+typedef struct {
+    FILE *file;
+    char *data;
+    size_t used;
+    int failed;
+} ExportBuffer;
+
+// One slice of a region being prefaulted
+typedef struct {
+    char *start;
+    size_t length;
+} PrefaultArgs;
+
+// HyperLogLog sketch of the distinct words seen, mergeable across workers
+typedef struct {
+    uint8_t registers[HLL_REGISTERS];
+} HyperLogLog;
+
+// Hot cache slot: a short word, its position in the main table and the
+// occurrences counted here since the last flush
+typedef struct {
+    uint32_t hash;
+    int index;                          // -1 marks an empty slot
+    int count;
+    int score;                          // hit credit, spent by conflicting misses
+    char key[HOT_CACHE_KEY_LENGTH];
+} HotCacheSlot;
+
+// Small direct-mapped cache of frequent words kept in front of the main table
+typedef struct {
+    HotCacheSlot slots[HOT_CACHE_SLOTS];
+    long long hits;
+    long long flushes;
+} HotCache;
+
+// Shared memory structure, the lock serializes the children's merges
+typedef struct {
+    pthread_mutex_t lock;
+    long long cache_hits;
+    long long cache_flushes;
+    int dropped;
+    int memory;                         // WC_MEMORY_* flags for the children's tables
+    int next_word;                      // next unclaimed word with dynamic chunks
+    double count_done;                  // when the last child finished counting
+    int size;
+    int capacity;
+    WordFreq data[];
+} SharedFreqData;
+
+// Per-thread work for the thread pool engine
+typedef struct {
+    char **words;
+    int start;
+    int end;
+    int thread_id;
+    int num_threads;
+    HyperLogLog *sketches;              // one per thread, indexed by thread id
+    double *estimated_distinct;
+    pthread_barrier_t *sketch_barrier;
+    StartGate *gate;
+    pthread_mutex_t *frequency_mutex;
+    WordFreqArray *shared_word_freq;
+    int *next_word;                     // NULL for one static chunk per thread
+    int chunk_words;
+    int last_word;                      // the cursor stops here
+    double count_done;
+    long long cache_hits;
+    long long cache_flushes;
+    int ok;                             // 0 once an allocation failed
+} ThreadArgs;
+
+struct WordCorpus {
+    char **words;
+    int total_words;
+    char **blocks;                      // backend buffers holding the words
+    int num_blocks;
+    size_t block_size;                  // size of the newest block
+};
+
+struct WordCountResult {
+    WordFreq *data;                     // sorted by frequency, descending
+    int size;
+    int *index;                         // hash slots holding position + 1, 0 if empty
+    size_t index_mask;
+    WordCountStats stats;
+};
+
+static int online_cpus(void) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus > 0 ? (int)cpus : 1;
+}
+
+static void* prefault_range(void *arg) {
+    PrefaultArgs *range = (PrefaultArgs*)arg;
+    for (size_t offset = 0; offset < range->length; offset += BASE_PAGE_SIZE) {
+        range->start[offset] = 0;
+    }
+    return NULL;
+}
+
+// Touch every page of a fresh region so its faults are taken now, spread
+// over the online CPUs
+static void prefault_region(char *region, size_t size) {
+    pthread_t threads[PREFAULT_MAX_THREADS];
+    PrefaultArgs ranges[PREFAULT_MAX_THREADS];
+    size_t pages = size / BASE_PAGE_SIZE;
+    int num_threads = online_cpus();
+    if (num_threads > PREFAULT_MAX_THREADS) num_threads = PREFAULT_MAX_THREADS;
+    if ((size_t)num_threads > size / HUGE_PAGE_SIZE) num_threads = (int)(size / HUGE_PAGE_SIZE);
+    if (num_threads < 1) num_threads = 1;
+
+    int started = 0;
+    for (int i = 0; i < num_threads; i++) {
+        size_t first = pages * i / num_threads;
+        size_t last = pages * (i + 1) / num_threads;
+        ranges[i].start = region + first * BASE_PAGE_SIZE;
+        ranges[i].length = (last - first) * BASE_PAGE_SIZE;
+        if (i == num_threads - 1 ||
+            pthread_create(&threads[i], NULL, prefault_range, &ranges[i]) != 0) {
+            prefault_range(&ranges[i]);
+        } else {
+            started++;
+        }
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+}
+
+// Map `*size` bytes of anonymous memory, on huge pages when asked and
+// available: the hugetlb pool first, then transparent huge pages, then base
+// pages. `*size` is rounded up to what was mapped. NULL on failure.
+static void* map_region(size_t *size, int shared, int memory, int *pages) {
+    int visibility = shared ? MAP_SHARED : MAP_PRIVATE;
+    int prefault = memory & WC_MEMORY_PREFAULT;
+    // With one CPU the kernel populates faster than a thread pool
+    int populate = prefault && online_cpus() == 1 ? MAP_POPULATE : 0;
+    void *region = MAP_FAILED;
+
+    *pages = WC_PAGES_SMALL;
+    if (memory & WC_MEMORY_HUGE_PAGES) {
+        size_t huge_size = (*size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+        region = mmap(NULL, huge_size, PROT_READ | PROT_WRITE,
+                      visibility | MAP_ANONYMOUS | MAP_HUGETLB | populate, -1, 0);
+        if (region != MAP_FAILED) {
+            *size = huge_size;
+            *pages = WC_PAGES_HUGETLB;
+        }
+    }
+    if (region == MAP_FAILED) {
+        // Populating before the advice would fault in base pages
+        int advise = memory & WC_MEMORY_HUGE_PAGES;
+        if (advise) {
+            populate = 0;
+        }
+        *size = (*size + BASE_PAGE_SIZE - 1) & ~((size_t)BASE_PAGE_SIZE - 1);
+        region = mmap(NULL, *size, PROT_READ | PROT_WRITE,
+                      visibility | MAP_ANONYMOUS | populate, -1, 0);
+        if (region == MAP_FAILED) {
+            return NULL;
+        }
+        if (advise && madvise(region, *size, MADV_HUGEPAGE) == 0) {
+            *pages = WC_PAGES_TRANSPARENT;
+        }
+    }
+    if (prefault && !populate) {
+        prefault_region(region, *size);
+    }
+    return region;
+}
+
+// Allocate a buffer from the memory backend. Large buffers are mapped per
+// the WC_MEMORY_* flags, everything else comes from the heap.
+static void* buffer_alloc(size_t size, int memory) {
+    BufferHeader *header;
+    size_t total = size + sizeof(BufferHeader);
+    if (memory && total >= MAPPED_MIN_SIZE) {
+        int pages;
+        header = map_region(&total, 0, memory, &pages);
+        if (!header) {
+            return NULL;
+        }
+        header->mapped = total;
+        header->pages = pages;
+    } else {
+        header = malloc(total);
+        if (!header) {
+            return NULL;
+        }
+        header->mapped = 0;
+        header->pages = WC_PAGES_SMALL;
+    }
+    return header + 1;
+}
+
+static void buffer_free(void *buffer) {
+    if (!buffer) {
+        return;
+    }
+    BufferHeader *header = (BufferHeader*)buffer - 1;
+    if (header->mapped) {
+        munmap(header, header->mapped);
+    } else {
+        free(header);
+    }
+}
+
+// Resize a backend buffer holding `used` bytes, NULL on failure
+static void* buffer_realloc(void *buffer, size_t used, size_t size, int memory) {
+    BufferHeader *header = (BufferHeader*)buffer - 1;
+    if (!header->mapped && (!memory || size + sizeof(BufferHeader) < MAPPED_MIN_SIZE)) {
+        header = realloc(header, size + sizeof(BufferHeader));
+        return header ? header + 1 : NULL;
+    }
+    void *resized = buffer_alloc(size, memory);
+    if (!resized) {
+        return NULL;
+    }
+    memcpy(resized, buffer, used < size ? used : size);
+    buffer_free(buffer);
+    return resized;
+}
+
+static int buffer_pages(const void *buffer) {
+    return ((const BufferHeader*)buffer - 1)->pages;
+}
+
+static void gate_init(StartGate *gate) {
+    pthread_mutex_init(&gate->lock, NULL);
+    pthread_cond_init(&gate->changed, NULL);
+    gate->state = 0;
+}
+
+// Open the gate (1) or call the pool off (-1)
+static void gate_release(StartGate *gate, int state) {
+    pthread_mutex_lock(&gate->lock);
+    gate->state = state;
+    pthread_cond_broadcast(&gate->changed);
+    pthread_mutex_unlock(&gate->lock);
+}
+
+// Wait for the gate, returns 0 if the pool was called off
+static int gate_wait(StartGate *gate) {
+    pthread_mutex_lock(&gate->lock);
+    while (gate->state == 0) {
+        pthread_cond_wait(&gate->changed, &gate->lock);
+    }
+    int open = gate->state > 0;
+    pthread_mutex_unlock(&gate->lock);
+    return open;
+}
+
+static void gate_destroy(StartGate *gate) {
+    pthread_cond_destroy(&gate->changed);
+    pthread_mutex_destroy(&gate->lock);
+}
+
+// Initialize word frequency array sized for the expected vocabulary, returns
+// 0 if it cannot be allocated
+static int init_word_freq_array(WordFreqArray *arr, int capacity, int memory) {
+    arr->data = buffer_alloc(capacity * sizeof(WordFreq), memory);
+    if (!arr->data) {
+        perror("Memory allocation failed");
+        return 0;
+    }
+    arr->size = 0;
+    arr->capacity = capacity;
+    arr->memory = memory;
+    return 1;
+}
+
+// Grow the array to hold at least `capacity` words, returns 0 if it cannot
+// grow; the array is left as it was then
+static int reserve_word_freq_array(WordFreqArray *arr, int capacity) {
+    if (capacity <= arr->capacity) {
+        return 1;
+    }
+    WordFreq *new_data = buffer_realloc(arr->data, arr->size * sizeof(WordFreq),
+                                        capacity * sizeof(WordFreq), arr->memory);
+    if (!new_data) {
+        perror("Memory reallocation failed");
+        return 0;
+    }
+    arr->data = new_data;
+    arr->capacity = capacity;
+    return 1;
+}
+
+// Append a word the array does not hold yet, returns its position or -1 if
+// the array cannot grow
+static int append_word_to_freq_array(WordFreqArray *arr, const char *word, int count, int first) {
+    // Resize array if needed
+    if (arr->size >= arr->capacity &&
+        !reserve_word_freq_array(arr, arr->capacity * GROWTH_FACTOR)) {
+        return -1;
+    }
+
+    // Add new word
+    strncpy(arr->data[arr->size].word, word, MAX_WORD_LENGTH - 1);
+    arr->data[arr->size].word[MAX_WORD_LENGTH - 1] = '\0';
+    arr->data[arr->size].frequency = count;
+    arr->data[arr->size].first = first;
+    return arr->size++;
+}
+
+// Add `count` occurrences of a word first seen at `first` with dynamic
+// resizing, returns its position or -1 if the array cannot grow
+static int add_word_to_freq_array(WordFreqArray *arr, const char *word, int count, int first) {
+    // Check if word already exists
+    for (int i = 0; i < arr->size; i++) {
+        if (strcmp(arr->data[i].word, word) == 0) {
+            arr->data[i].frequency += count;
+            if (first < arr->data[i].first) {
+                arr->data[i].first = first;
+            }
+            return i;
+        }
+    }
+    return append_word_to_freq_array(arr, word, count, first);
+}
+
+// Ranking key: most frequent first, then earliest first occurrence
+static uint64_t rank_key(const WordFreq *entry) {
+    return ((uint64_t)~(uint32_t)entry->frequency << 32) | (uint32_t)entry->first;
+}
+
+// One thread of the ranking: build its slice of keys, take part in every
+// radix pass, then gather its slice of the table in ranked order
+static void* rank_worker(void *arg) {
+    RankWorkerArgs *worker = (RankWorkerArgs*)arg;
+    RankingJob *job = worker->job;
+    int thread_id = worker->thread_id;
+    if (!gate_wait(job->gate)) {
+        return NULL;
+    }
+    int lo = (int)((long long)job->size * thread_id / job->num_threads);
+    int hi = (int)((long long)job->size * (thread_id + 1) / job->num_threads);
+    size_t *histogram = job->histograms + (size_t)thread_id * RADIX_BUCKETS;
+
+    // Keys, and which of their bits differ at all
+    uint64_t reference = rank_key(&job->data[0]);
+    uint64_t differing = 0;
+    for (int i = lo; i < hi; i++) {
+        job->entries[i].key = rank_key(&job->data[i]);
+        job->entries[i].index = i;
+        differing |= job->entries[i].key ^ reference;
+    }
+    job->differing[thread_id] = differing;
+    if (pthread_barrier_wait(job->barrier) == PTHREAD_BARRIER_SERIAL_THREAD) {
+        for (int i = 1; i < job->num_threads; i++) {
+            job->differing[0] |= job->differing[i];
+        }
+    }
+    pthread_barrier_wait(job->barrier);
+    differing = job->differing[0];
+
+    RankEntry *src = job->entries;
+    RankEntry *dst = job->scratch;
+    for (int shift = 0; shift < 64; shift += RADIX_BITS) {
+        // A digit every key shares leaves the order as it is
+        if (((differing >> shift) & (RADIX_BUCKETS - 1)) == 0) {
+            continue;
+        }
+
+        memset(histogram, 0, RADIX_BUCKETS * sizeof(size_t));
+        for (int i = lo; i < hi; i++) {
+            histogram[(src[i].key >> shift) & (RADIX_BUCKETS - 1)]++;
+        }
+
+        // Turn the counts into scatter offsets, digit-major and thread-minor
+        // so equal digits keep their order and every pass stays stable
+        if (pthread_barrier_wait(job->barrier) == PTHREAD_BARRIER_SERIAL_THREAD) {
+            size_t offset = 0;
+            for (int digit = 0; digit < RADIX_BUCKETS; digit++) {
+                for (int t = 0; t < job->num_threads; t++) {
+                    size_t count = job->histograms[(size_t)t * RADIX_BUCKETS + digit];
+                    job->histograms[(size_t)t * RADIX_BUCKETS + digit] = offset;
+                    offset += count;
+                }
+            }
+        }
+        pthread_barrier_wait(job->barrier);
+
+        for (int i = lo; i < hi; i++) {
+            dst[histogram[(src[i].key >> shift) & (RADIX_BUCKETS - 1)]++] = src[i];
+        }
+        pthread_barrier_wait(job->barrier);
+
+        RankEntry *swap = src;
+        src = dst;
+        dst = swap;
+    }
+
+    for (int i = lo; i < hi; i++) {
+        job->ranked[i] = job->data[src[i].index];
+    }
+    return NULL;
+}
+
+// Rank a table by frequency, descending, ties broken by first occurrence,
+// with a parallel LSD radix sort on (count, first occurrence) keys. The
+// ranked table replaces the unsorted one. Returns 0, with the table left
+// unsorted, if the sort cannot get its memory or threads.
+static int rank_word_freq(WordFreqArray *arr) {
+    if (arr->size < 2) {
+        return 1;
+    }
+    int num_threads = arr->size < RANK_PARALLEL_MIN ? 1 : online_cpus();
+    if (num_threads > MAX_THREADS) num_threads = MAX_THREADS;
+
+    RankingJob job;
+    pthread_barrier_t barrier;
+    StartGate gate;
+    job.data = arr->data;
+    job.size = arr->size;
+    job.num_threads = num_threads;
+    job.entries = malloc(arr->size * sizeof(RankEntry));
+    job.scratch = malloc(arr->size * sizeof(RankEntry));
+    job.histograms = malloc((size_t)num_threads * RADIX_BUCKETS * sizeof(size_t));
+    job.differing = malloc(num_threads * sizeof(uint64_t));
+    job.ranked = buffer_alloc(arr->capacity * sizeof(WordFreq), arr->memory);
+    job.barrier = &barrier;
+    job.gate = &gate;
+    int ok = job.entries && job.scratch && job.histograms && job.differing && job.ranked;
+    if (!ok) {
+        perror("Memory allocation failed");
+    } else {
+        pthread_barrier_init(&barrier, NULL, num_threads);
+        gate_init(&gate);
+
+        pthread_t threads[MAX_THREADS];
+        RankWorkerArgs workers[MAX_THREADS];
+        for (int i = 0; i < num_threads; i++) {
+            workers[i].job = &job;
+            workers[i].thread_id = i;
+        }
+        int started = 1;
+        for (; started < num_threads && ok; started++) {
+            if (pthread_create(&threads[started], NULL, rank_worker, &workers[started]) != 0) {
+                perror("Thread creation failed");
+                ok = 0;
+                break;
+            }
+        }
+        gate_release(&gate, ok ? 1 : -1);
+        if (ok) {
+            rank_worker(&workers[0]);
+        }
+        for (int i = 1; i < started; i++) {
+            pthread_join(threads[i], NULL);
+        }
+        gate_destroy(&gate);
+        pthread_barrier_destroy(&barrier);
+    }
+
+    free(job.entries);
+    free(job.scratch);
+    free(job.histograms);
+    free(job.differing);
+    if (!ok) {
+        buffer_free(job.ranked);
+        return 0;
+    }
+    buffer_free(arr->data);
+    arr->data = job.ranked;
+    return 1;
+}
+
+// 64-bit word hash (FNV-1a plus a final mix)
+static uint64_t word_hash(const char *word) {
+    uint64_t h = 1469598103934665603ULL;
+    while (*word) {
+        h ^= (unsigned char)*word++;
+        h *= 1099511628211ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// Record one word in the sketch
+static void hll_add(HyperLogLog *hll, const char *word) {
+    uint64_t hash = word_hash(word);
+    int index = (int)(hash >> (64 - HLL_PRECISION));
+    uint64_t rest = (hash << HLL_PRECISION) | (1ULL << (HLL_PRECISION - 1));
+    uint8_t rank = (uint8_t)(__builtin_clzll(rest) + 1);
+    if (rank > hll->registers[index]) {
+        hll->registers[index] = rank;
+    }
+}
+
+// Fold another sketch into this one
+static void hll_merge(HyperLogLog *hll, const HyperLogLog *other) {
+    for (int i = 0; i < HLL_REGISTERS; i++) {
+        if (other->registers[i] > hll->registers[i]) {
+            hll->registers[i] = other->registers[i];
+        }
+    }
+}
+
+// Estimated number of distinct words, with the small-range correction
+static double hll_estimate(const HyperLogLog *hll) {
+    double sum = 0.0;
+    int zeros = 0;
+    for (int i = 0; i < HLL_REGISTERS; i++) {
+        sum += 1.0 / (double)(1ULL << hll->registers[i]);
+        if (hll->registers[i] == 0) {
+            zeros++;
+        }
+    }
+    double m = HLL_REGISTERS;
+    double estimate = (0.7213 / (1.0 + 1.079 / m)) * m * m / sum;
+    if (estimate <= 2.5 * m && zeros > 0) {
+        estimate = m * log(m / zeros);
+    }
+    return estimate;
+}
+
+// Sketch words [start, end) into `hll`
+static void hll_add_range(HyperLogLog *hll, char **words, int start, int end) {
+    for (int i = start; i < end; i++) {
+        hll_add(hll, words[i]);
+    }
+}
+
+// Table capacity for an estimated vocabulary, tables still grow past it
+static int capacity_for_estimate(double estimate) {
+    return (int)(estimate * TABLE_HEADROOM) + MIN_TABLE_CAPACITY;
+}
+
+// Monotonic wall clock in seconds, comparable across processes
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Minor page faults of this process and its reaped children
+static long long minor_faults(void) {
+    struct rusage self, children;
+    getrusage(RUSAGE_SELF, &self);
+    getrusage(RUSAGE_CHILDREN, &children);
+    return self.ru_minflt + children.ru_minflt;
+}
+
+// Counter of dTLB load misses in user space, inherited by threads and
+// children created after it, -1 if the host does not expose one
+static int open_dtlb_counter(void) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static long long read_dtlb_counter(int fd) {
+    long long misses = -1;
+    if (fd < 0 || read(fd, &misses, sizeof(misses)) != sizeof(misses)) {
+        misses = -1;
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+    return misses;
+}
+
+// Peak resident set size in MB, of this process or of its largest child
+static double peak_rss_mb(int who) {
+    struct rusage usage;
+    getrusage(who, &usage);
+    return usage.ru_maxrss / 1024.0;
+}
+
+// FNV-1a hash used to pick a hot cache slot
+static uint32_t hot_cache_hash(const char *word, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)word[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Start with every slot empty
+static void init_hot_cache(HotCache *cache) {
+    memset(cache, 0, sizeof(HotCache));
+    for (int i = 0; i < HOT_CACHE_SLOTS; i++) {
+        cache->slots[i].index = -1;
+    }
+}
+
+// Count the word locally if it is cached, returns 1 on a hit
+static int hot_cache_hit(HotCache *cache, const char *word, size_t len, uint32_t hash) {
+    HotCacheSlot *slot = &cache->slots[hash & (HOT_CACHE_SLOTS - 1)];
+    if (slot->index >= 0 && slot->hash == hash && memcmp(slot->key, word, len + 1) == 0) {
+        slot->count++;
+        if (slot->score < HOT_CACHE_MAX_SCORE) {
+            slot->score++;
+        }
+        cache->hits++;
+        return 1;
+    }
+    return 0;
+}
+
+// Offer a word that missed the cache and was counted in the main table at
+// `index`; it takes the slot only once the current word has no hit credit left
+static void hot_cache_admit(HotCache *cache, WordFreq *data, const char *word, size_t len,
+                            uint32_t hash, int index) {
+    HotCacheSlot *slot = &cache->slots[hash & (HOT_CACHE_SLOTS - 1)];
+    if (slot->index >= 0) {
+        if (slot->score > 0) {
+            slot->score--;
+            return;
+        }
+        data[slot->index].frequency += slot->count;
+    }
+    slot->hash = hash;
+    slot->index = index;
+    slot->count = 0;
+    slot->score = 0;
+    memcpy(slot->key, word, len + 1);
+}
+
+// Move the locally counted occurrences into the main table
+static void hot_cache_flush(HotCache *cache, WordFreq *data) {
+    for (int i = 0; i < HOT_CACHE_SLOTS; i++) {
+        HotCacheSlot *slot = &cache->slots[i];
+        if (slot->index >= 0 && slot->count > 0) {
+            data[slot->index].frequency += slot->count;
+            slot->count = 0;
+        }
+    }
+    cache->flushes++;
+}
+
+// Count words [start, end) into `word_freq`, frequent words go through the
+// hot cache first. This is the inner loop of every engine. Returns 0 if the
+// table cannot grow.
+static int count_chunk(char **words, int start, int end, WordFreqArray *word_freq,
+                       HotCache *cache) {
+    for (int i = start; i < end; i++) {
+        // Periodically push the cached counts into the main table
+        if ((i - start) % HOT_CACHE_FLUSH_INTERVAL == 0 && i > start) {
+            hot_cache_flush(cache, word_freq->data);
+        }
+
+        // Most tokens are a handful of short, frequent words
+        size_t len = strlen(words[i]);
+        int cacheable = len < HOT_CACHE_KEY_LENGTH;
+        uint32_t hash = cacheable ? hot_cache_hash(words[i], len) : 0;
+        if (cacheable && hot_cache_hit(cache, words[i], len, hash)) {
+            continue;
+        }
+
+        int index = add_word_to_freq_array(word_freq, words[i], 1, i);
+        if (index < 0) {
+            return 0;
+        }
+        if (cacheable) {
+            hot_cache_admit(cache, word_freq->data, words[i], len, hash, index);
+        }
+    }
+    hot_cache_flush(cache, word_freq->data);
+    return 1;
+}
+
+// Count chunks of `chunk_words` claimed from a shared cursor until `end`,
+// returns 0 if the table cannot grow
+static int count_dynamic_chunks(char **words, int *next_word, int chunk_words, int end,
+                                WordFreqArray *word_freq, HotCache *cache) {
+    for (;;) {
+        int start = __atomic_fetch_add(next_word, chunk_words, __ATOMIC_RELAXED);
+        if (start >= end) {
+            return 1;
+        }
+        if (!count_chunk(words, start, start + chunk_words < end ? start + chunk_words : end,
+                         word_freq, cache)) {
+            return 0;
+        }
+    }
+}
+
+// Bounds of chunk `i` when `total` items are split into `parts` chunks
+static void chunk_bounds(int total, int parts, int i, int *start, int *end) {
+    int chunk_size = total / parts;
+    int remainder = total % parts;
+    *start = i * chunk_size + (i < remainder ? i : remainder);
+    *end = *start + chunk_size + (i < remainder ? 1 : 0);
+}
+
+// Number of memory domains (NUMA nodes) on this host, 1 if unknown
+static int count_memory_domains(void) {
+    DIR *dir = opendir("/sys/devices/system/node");
+    if (!dir) {
+        return 1;
+    }
+    int nodes = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strncmp(entry->d_name, "node", 4) == 0 &&
+            entry->d_name[4] >= '0' && entry->d_name[4] <= '9') {
+            nodes++;
+        }
+    }
+    closedir(dir);
+    return nodes > 0 ? nodes : 1;
+}
+
+// Pin the calling process to the CPUs of one memory domain, so its threads
+// and the pages they first touch stay on that node. Returns 1 on success.
+static int bind_to_memory_domain(int node) {
+    char path[64];
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return 0;
+    }
+
+    // cpulist looks like "0-3,8-11"
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    int first, last;
+    char separator;
+    while (fscanf(file, "%d", &first) == 1) {
+        last = first;
+        if (fscanf(file, "%c", &separator) == 1 && separator == '-') {
+            if (fscanf(file, "%d", &last) != 1) break;
+            if (fscanf(file, "%c", &separator) != 1) separator = '\n';
+        }
+        for (int cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++) {
+            CPU_SET(cpu, &cpus);
+        }
+        if (separator != ',') break;
+    }
+    fclose(file);
+
+    return CPU_COUNT(&cpus) > 0 && sched_setaffinity(0, sizeof(cpus), &cpus) == 0;
+}
+
+// Thread function: sketch and count a chunk locally, then merge into the shared array
+static void* process_word_chunk(void *arg) {
+    ThreadArgs *thread_args = (ThreadArgs*)arg;
+    if (!gate_wait(thread_args->gate)) {
+        return NULL;
+    }
+
+    // Sketch this chunk's vocabulary to size the local array
+    HyperLogLog *sketch = &thread_args->sketches[thread_args->thread_id];
+    hll_add_range(sketch, thread_args->words, thread_args->start, thread_args->end);
+    double local_estimate = hll_estimate(sketch);
+
+    // Once every sketch is done, one thread merges them and sizes the shared
+    // array. This happens before counting, so threads that finish counting
+    // early merge while the others are still counting.
+    if (pthread_barrier_wait(thread_args->sketch_barrier) == PTHREAD_BARRIER_SERIAL_THREAD) {
+        for (int i = 1; i < thread_args->num_threads; i++) {
+            hll_merge(&thread_args->sketches[0], &thread_args->sketches[i]);
+        }
+        *thread_args->estimated_distinct = hll_estimate(&thread_args->sketches[0]);
+        thread_args->ok = reserve_word_freq_array(thread_args->shared_word_freq,
+                                                  capacity_for_estimate(*thread_args->estimated_distinct));
+    }
+    pthread_barrier_wait(thread_args->sketch_barrier);
+
+    // Local frequency array for thread
+    WordFreqArray local_word_freq;
+    if (!init_word_freq_array(&local_word_freq, capacity_for_estimate(local_estimate),
+                              thread_args->shared_word_freq->memory)) {
+        thread_args->ok = 0;
+        return NULL;
+    }
+
+    HotCache cache;
+    init_hot_cache(&cache);
+    int counted;
+    if (thread_args->next_word) {
+        counted = count_dynamic_chunks(thread_args->words, thread_args->next_word,
+                                       thread_args->chunk_words, thread_args->last_word,
+                                       &local_word_freq, &cache);
+    } else {
+        counted = count_chunk(thread_args->words, thread_args->start, thread_args->end,
+                              &local_word_freq, &cache);
+    }
+    thread_args->count_done = now_seconds();
+    thread_args->cache_hits = cache.hits;
+    thread_args->cache_flushes = cache.flushes;
+
+    // Merge local results with shared array
+    pthread_mutex_lock(thread_args->frequency_mutex);
+    for (int i = 0; i < local_word_freq.size && counted; i++) {
+        counted = add_word_to_freq_array(thread_args->shared_word_freq, local_word_freq.data[i].word,
+                                         local_word_freq.data[i].frequency,
+                                         local_word_freq.data[i].first) >= 0;
+    }
+    pthread_mutex_unlock(thread_args->frequency_mutex);
+    if (!counted) {
+        thread_args->ok = 0;
+    }
+
+    buffer_free(local_word_freq.data);
+    return NULL;
+}
+
+// Count words [start, end) with a pool of threads into `word_freq`. With a
+// `next_word` cursor the threads claim chunks of `chunk_words` from it (up to
+// `last_word`, which may lie past `end` when other processes share the
+// cursor) instead of taking one static chunk each; [start, end) is still what
+// they sketch to size their tables. Sets `count_done` to when the last
+// thread finished counting; returns 0 if a thread could not be started or
+// ran out of memory.
+static int count_with_threads(char **words, int start, int end, int num_threads,
+                              int *next_word, int chunk_words, int last_word,
+                              WordFreqArray *word_freq, WordCountStats *stats,
+                              double *count_done) {
+    pthread_t threads[MAX_THREADS];
+    ThreadArgs thread_args[MAX_THREADS];
+    pthread_mutex_t frequency_mutex = PTHREAD_MUTEX_INITIALIZER;
+    pthread_barrier_t sketch_barrier;
+    StartGate gate;
+    double estimated_distinct = 0.0;
+
+    HyperLogLog *sketches = calloc(num_threads, sizeof(HyperLogLog));
+    if (!sketches) {
+        perror("Memory allocation failed");
+        return 0;
+    }
+    pthread_barrier_init(&sketch_barrier, NULL, num_threads);
+    gate_init(&gate);
+
+    // Create threads
+    for (int i = 0; i < num_threads; i++) {
+        int chunk_start, chunk_end;
+        chunk_bounds(end - start, num_threads, i, &chunk_start, &chunk_end);
+
+        thread_args[i].words = words;
+        thread_args[i].start = start + chunk_start;
+        thread_args[i].end = start + chunk_end;
+        thread_args[i].thread_id = i;
+        thread_args[i].num_threads = num_threads;
+        thread_args[i].sketches = sketches;
+        thread_args[i].estimated_distinct = &estimated_distinct;
+        thread_args[i].sketch_barrier = &sketch_barrier;
+        thread_args[i].gate = &gate;
+        thread_args[i].frequency_mutex = &frequency_mutex;
+        thread_args[i].shared_word_freq = word_freq;
+        thread_args[i].next_word = next_word;
+        thread_args[i].chunk_words = chunk_words;
+        thread_args[i].last_word = last_word;
+        thread_args[i].count_done = 0.0;
+        thread_args[i].cache_hits = 0;
+        thread_args[i].cache_flushes = 0;
+        thread_args[i].ok = 1;
+    }
+
+    // Threads wait at the gate until all of them exist, so a failed start
+    // cannot leave the others blocked on the sketch barrier
+    int started = 0;
+    int ok = 1;
+    for (; started < num_threads; started++) {
+        if (pthread_create(&threads[started], NULL, process_word_chunk, &thread_args[started]) != 0) {
+            perror("Thread creation failed");
+            ok = 0;
+            break;
+        }
+    }
+    gate_release(&gate, ok ? 1 : -1);
+
+    // Wait for all threads to complete
+    *count_done = 0.0;
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+        ok = ok && thread_args[i].ok;
+        stats->cache_hits += thread_args[i].cache_hits;
+        stats->cache_flushes += thread_args[i].cache_flushes;
+        if (thread_args[i].count_done > *count_done) {
+            *count_done = thread_args[i].count_done;
+        }
+    }
+    stats->estimated_distinct = estimated_distinct;
+
+    gate_destroy(&gate);
+    pthread_barrier_destroy(&sketch_barrier);
+    free(sketches);
+    return ok;
+}
+
+// Words per dynamically claimed chunk, 0 keeps one static chunk per worker
+static int chunk_words_for(int total_words, int workers, int chunks_per_worker) {
+    if (chunks_per_worker <= 1) {
+        return 0;
+    }
+    int chunk_words = total_words / (workers * chunks_per_worker);
+    return chunk_words > 0 ? chunk_words : 1;
+}
+
+// Estimated vocabulary of a whole corpus, negative if there is no memory
+static double sketch_corpus(const WordCorpus *corpus) {
+    HyperLogLog *sketch = calloc(1, sizeof(HyperLogLog));
+    if (!sketch) {
+        perror("Memory allocation failed");
+        return -1.0;
+    }
+    hll_add_range(sketch, corpus->words, 0, corpus->total_words);
+    double estimate = hll_estimate(sketch);
+    free(sketch);
+    return estimate;
+}
+
+// Slot of `word` in an open-addressing index of positions + 1 into `data`,
+// or the empty slot where it belongs
+static size_t find_index_slot(const int *index, size_t mask, const WordFreq *data,
+                              const char *word) {
+    size_t slot = word_hash(word) & mask;
+    while (index[slot] != 0 && strcmp(data[index[slot] - 1].word, word) != 0) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+// Index over the first `size` words of `data` with room for `reserve` words
+// at <= 50% load, NULL on failure
+static int* build_word_index(const WordFreq *data, int size, int reserve, size_t *mask) {
+    size_t capacity = 16;
+    while (capacity < (size_t)reserve * 2) {
+        capacity *= 2;
+    }
+    int *index = calloc(capacity, sizeof(int));
+    if (!index) {
+        perror("Memory allocation failed");
+        return NULL;
+    }
+    *mask = capacity - 1;
+
+    for (int i = 0; i < size; i++) {
+        size_t slot = word_hash(data[i].word) & *mask;
+        while (index[slot] != 0) {
+            slot = (slot + 1) & *mask;
+        }
+        index[slot] = i + 1;
+    }
+    return index;
+}
+
+// Engines return 0 on failure, leaving `word_freq->data` NULL or holding
+// whatever was counted so the caller can free it
+
+// Sequential engine
+static int count_naive(const WordCorpus *corpus, int memory, WordFreqArray *word_freq,
+                       WordCountStats *stats) {
+    double start = now_seconds();
+    stats->estimated_distinct = sketch_corpus(corpus);
+    if (stats->estimated_distinct < 0 ||
+        !init_word_freq_array(word_freq, capacity_for_estimate(stats->estimated_distinct), memory)) {
+        return 0;
+    }
+    double counting = now_seconds();
+
+    HotCache cache;
+    init_hot_cache(&cache);
+    if (!count_chunk(corpus->words, 0, corpus->total_words, word_freq, &cache)) {
+        return 0;
+    }
+    stats->cache_hits = cache.hits;
+    stats->cache_flushes = cache.flushes;
+
+    stats->setup_seconds = counting - start;
+    stats->count_seconds = now_seconds() - counting;
+    stats->pages = buffer_pages(word_freq->data);
+    return 1;
+}
+
+// Sequential engine looking words up through a hash index, so its cost does
+// not grow with the vocabulary
+static int count_indexed(const WordCorpus *corpus, int memory, WordFreqArray *word_freq,
+                         WordCountStats *stats) {
+    double start = now_seconds();
+    stats->estimated_distinct = sketch_corpus(corpus);
+    if (stats->estimated_distinct < 0 ||
+        !init_word_freq_array(word_freq, capacity_for_estimate(stats->estimated_distinct), memory)) {
+        return 0;
+    }
+    size_t mask;
+    int *index = build_word_index(word_freq->data, 0, word_freq->capacity, &mask);
+    if (!index) {
+        return 0;
+    }
+    double counting = now_seconds();
+
+    for (int i = 0; i < corpus->total_words; i++) {
+        const char *word = corpus->words[i];
+        size_t slot = find_index_slot(index, mask, word_freq->data, word);
+        if (index[slot] != 0) {
+            word_freq->data[index[slot] - 1].frequency++;
+            continue;
+        }
+        int position = append_word_to_freq_array(word_freq, word, 1, i);
+        if (position < 0) {
+            free(index);
+            return 0;
+        }
+        index[slot] = position + 1;
+
+        // Rebuild the index at twice the size once it is half full
+        if ((size_t)word_freq->size * 2 > mask) {
+            free(index);
+            index = build_word_index(word_freq->data, word_freq->size,
+                                     word_freq->size * GROWTH_FACTOR, &mask);
+            if (!index) {
+                return 0;
+            }
+        }
+    }
+    free(index);
+
+    stats->setup_seconds = counting - start;
+    stats->count_seconds = now_seconds() - counting;
+    stats->pages = buffer_pages(word_freq->data);
+    return 1;
+}
+
+// Thread pool engine
+static int count_threads(const WordCorpus *corpus, int num_threads, int chunks_per_worker,
+                         int memory, WordFreqArray *word_freq, WordCountStats *stats) {
+    double start = now_seconds();
+    if (!init_word_freq_array(word_freq, MIN_TABLE_CAPACITY, memory)) {
+        return 0;
+    }
+    int next_word = 0;
+    int chunk_words = chunk_words_for(corpus->total_words, num_threads, chunks_per_worker);
+
+    double counting = now_seconds();
+    double count_done;
+    if (!count_with_threads(corpus->words, 0, corpus->total_words, num_threads,
+                            chunk_words ? &next_word : NULL, chunk_words,
+                            corpus->total_words, word_freq, stats, &count_done)) {
+        return 0;
+    }
+
+    stats->setup_seconds = counting - start;
+    stats->count_seconds = count_done - counting;
+    stats->merge_seconds = now_seconds() - count_done;
+    stats->pages = buffer_pages(word_freq->data);
+    return 1;
+}
+
+// Child process: count its chunk, alone or with a thread pool, and merge the
+// result into shared memory; 0 if it could not count, and the parent then
+// fails the run
+static int run_child_process(int process, const WordCorpus *corpus, int start, int end,
+                             int num_threads, int chunk_words, const HyperLogLog *sketch,
+                             SharedFreqData *shared_data) {
+    WordFreqArray local_freq;
+    WordCountStats stats;
+    memset(&stats, 0, sizeof(stats));
+    if (!init_word_freq_array(&local_freq, capacity_for_estimate(hll_estimate(sketch)),
+                              shared_data->memory)) {
+        return 0;
+    }
+
+    // With dynamic chunks every worker of every process claims chunks from
+    // the cursor in shared memory, across the whole corpus; the static share
+    // [start, end) still sizes the tables, as each process counts about that much
+    int *next_word = chunk_words ? &shared_data->next_word : NULL;
+    int last_word = chunk_words ? corpus->total_words : end;
+
+    double count_done;
+    int counted;
+    if (num_threads > 1) {
+        counted = count_with_threads(corpus->words, start, end, num_threads, next_word,
+                                     chunk_words, last_word, &local_freq, &stats, &count_done);
+    } else {
+        HotCache cache;
+        init_hot_cache(&cache);
+        if (next_word) {
+            counted = count_dynamic_chunks(corpus->words, next_word, chunk_words, last_word,
+                                           &local_freq, &cache);
+        } else {
+            counted = count_chunk(corpus->words, start, end, &local_freq, &cache);
+        }
+        count_done = now_seconds();
+        stats.cache_hits = cache.hits;
+        stats.cache_flushes = cache.flushes;
+    }
+    if (!counted) {
+        buffer_free(local_freq.data);
+        return 0;
+    }
+
+    // Transfer to shared memory under the process-shared lock
+    int dropped = 0;
+    pthread_mutex_lock(&shared_data->lock);
+    for (int j = 0; j < local_freq.size; j++) {
+        int found = 0;
+        for (int k = 0; k < shared_data->size; k++) {
+            if (strcmp(shared_data->data[k].word, local_freq.data[j].word) == 0) {
+                shared_data->data[k].frequency += local_freq.data[j].frequency;
+                if (local_freq.data[j].first < shared_data->data[k].first) {
+                    shared_data->data[k].first = local_freq.data[j].first;
+                }
+                found = 1;
+                break;
+            }
+        }
+
+        // Add new word if not found
+        if (!found && shared_data->size < shared_data->capacity) {
+            shared_data->data[shared_data->size] = local_freq.data[j];
+            shared_data->size++;
+        } else if (!found) {
+            dropped++;
+        }
+    }
+    shared_data->cache_hits += stats.cache_hits;
+    shared_data->cache_flushes += stats.cache_flushes;
+    shared_data->dropped += dropped;
+    if (count_done > shared_data->count_done) {
+        shared_data->count_done = count_done;
+    }
+    pthread_mutex_unlock(&shared_data->lock);
+
+    // Words past the shared capacity are lost, so say so
+    if (dropped > 0) {
+        fprintf(stderr, "Process %d: shared table full, dropped %d distinct words "
+                        "(use externalAggregation for large vocabularies)\n", process, dropped);
+    }
+
+    buffer_free(local_freq.data);
+    return 1;
+}
+
+// Process engines: fork children that merge through a shared mapping.
+// With one thread per process this is the multiprocessing engine, with more
+// it is the hybrid engine, bound to memory domains when the host has several.
+static int count_with_processes(const WordCorpus *corpus, int num_processes, int num_threads,
+                                int chunks_per_worker, int memory, WordFreqArray *word_freq,
+                                WordCountStats *stats) {
+    double setup_start = now_seconds();
+
+    // Sketch each chunk's vocabulary; children size their local arrays from
+    // their own sketch, the shared region is sized from the merged one
+    HyperLogLog *sketches = calloc(num_processes + 1, sizeof(HyperLogLog));
+    if (!sketches) {
+        perror("Memory allocation failed");
+        return 0;
+    }
+    for (int i = 0; i < num_processes; i++) {
+        int start, end;
+        chunk_bounds(corpus->total_words, num_processes, i, &start, &end);
+        hll_add_range(&sketches[i], corpus->words, start, end);
+        hll_merge(&sketches[num_processes], &sketches[i]);
+    }
+    stats->estimated_distinct = hll_estimate(&sketches[num_processes]);
+    int shared_capacity = capacity_for_estimate(stats->estimated_distinct);
+    size_t shared_size = sizeof(SharedFreqData) + (size_t)shared_capacity * sizeof(WordFreq);
+
+    // Create shared memory for word frequencies
+    int pages;
+    SharedFreqData *shared_data = map_region(&shared_size, 1, memory, &pages);
+    if (!shared_data) {
+        perror("mmap failed");
+        free(sketches);
+        return 0;
+    }
+    stats->pages = pages;
+
+    // Process-shared mutex guarding the shared table
+    pthread_mutexattr_t lock_attr;
+    pthread_mutexattr_init(&lock_attr);
+    pthread_mutexattr_setpshared(&lock_attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutex_init(&shared_data->lock, &lock_attr);
+    pthread_mutexattr_destroy(&lock_attr);
+    shared_data->capacity = shared_capacity;
+    shared_data->memory = memory;
+    int chunk_words = chunk_words_for(corpus->total_words, num_processes * num_threads,
+                                      chunks_per_worker);
+
+    double counting = now_seconds();
+    int bind_domains = num_threads > 1 && stats->memory_domains > 1;
+    pid_t pids[MAX_PROCESSES];
+    for (int i = 0; i < num_processes; i++) {
+        pids[i] = fork();
+
+        if (pids[i] == -1) {
+            perror("fork failed");
+            for (int j = 0; j < i; j++) {
+                waitpid(pids[j], NULL, 0);
+            }
+            munmap(shared_data, shared_size);
+            free(sketches);
+            return 0;
+        } else if (pids[i] == 0) {
+            // Child process
+            if (bind_domains) {
+                bind_to_memory_domain(i % stats->memory_domains);
+            }
+            int start, end;
+            chunk_bounds(corpus->total_words, num_processes, i, &start, &end);
+            int ok = run_child_process(i, corpus, start, end, num_threads, chunk_words,
+                                       &sketches[i], shared_data);
+            _exit(ok ? 0 : 1);
+        }
+    }
+
+    // Parent process waits for every child; the shared table is incomplete
+    // if any of them failed or was killed
+    int ok = 1;
+    for (int i = 0; i < num_processes; i++) {
+        int status;
+        waitpid(pids[i], &status, 0);
+
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            fprintf(stderr, "Child process %d failed\n", pids[i]);
+            ok = 0;
+        }
+    }
+    free(sketches);
+    stats->setup_seconds = counting - setup_start;
+    stats->count_seconds = shared_data->count_done - counting;
+    stats->merge_seconds = now_seconds() - shared_data->count_done;
+
+    // Copy the shared table out so the result outlives the mapping
+    if (ok && init_word_freq_array(word_freq, shared_data->size > 0 ? shared_data->size : 1, memory)) {
+        memcpy(word_freq->data, shared_data->data, shared_data->size * sizeof(WordFreq));
+        word_freq->size = shared_data->size;
+        stats->cache_hits = shared_data->cache_hits;
+        stats->cache_flushes = shared_data->cache_flushes;
+        stats->dropped_words = shared_data->dropped;
+    } else {
+        ok = 0;
+    }
+
+    pthread_mutex_destroy(&shared_data->lock);
+    munmap(shared_data, shared_size);
+    return ok;
+}
+
+// Hash index used by wc_lookup, 0 on failure
+static int build_result_index(WordCountResult *result) {
+    result->index = build_word_index(result->data, result->size, result->size,
+                                     &result->index_mask);
+    return result->index != NULL;
+}
+
+// Copy a word into the corpus blocks, starting a new block when it is full.
+// The first block is sized by the caller, later ones double up to
+// CORPUS_BLOCK_SIZE.
+static char* store_word(WordCorpus *corpus, size_t *block_used, const char *word, int memory) {
+    size_t length = strlen(word) + 1;
+    if (corpus->num_blocks == 0 || *block_used + length > corpus->block_size) {
+        char **blocks = realloc(corpus->blocks, (corpus->num_blocks + 1) * sizeof(char*));
+        if (!blocks) {
+            return NULL;
+        }
+        corpus->blocks = blocks;
+        if (corpus->num_blocks > 0 && corpus->block_size < CORPUS_BLOCK_SIZE) {
+            corpus->block_size *= GROWTH_FACTOR;
+        }
+        corpus->blocks[corpus->num_blocks] = buffer_alloc(corpus->block_size, memory);
+        if (!corpus->blocks[corpus->num_blocks]) {
+            return NULL;
+        }
+        corpus->num_blocks++;
+        *block_used = 0;
+    }
+    char *stored = corpus->blocks[corpus->num_blocks - 1] + *block_used;
+    memcpy(stored, word, length);
+    *block_used += length;
+    return stored;
+}
+
+WordCorpus* wc_corpus_open(const char *filename) {
+    return wc_corpus_load(filename, 0);
+}
+
+// Read words from input file with dynamic memory allocation
+WordCorpus* wc_corpus_load(const char *filename, int memory) {
+    FILE *file = fopen(filename, "r");
+    if (!file) {
+        perror("Error opening file");
+        return NULL;
+    }
+
+    WordCorpus *corpus = calloc(1, sizeof(WordCorpus));
+    if (!corpus) {
+        perror("Memory allocation failed");
+        fclose(file);
+        return NULL;
+    }
+
+    // Size the buffers from the file so small inputs do not reserve (and
+    // prefault) room for text8: a word and its separator take at least two
+    // bytes, and stored words take at most the file size plus a terminator
+    // for every piece of an over-long word
+    struct stat st;
+    size_t file_size = fstat(fileno(file), &st) == 0 && st.st_size > 0 ? (size_t)st.st_size : 0;
+    int capacity = INITIAL_CAPACITY;
+    if (file_size / 2 + 1 < (size_t)capacity) {
+        capacity = (int)(file_size / 2 + 1);
+    }
+    corpus->block_size = file_size + file_size / (MAX_WORD_LENGTH - 1) + 2;
+    if (corpus->block_size < MIN_CORPUS_BLOCK_SIZE) corpus->block_size = MIN_CORPUS_BLOCK_SIZE;
+    if (corpus->block_size > CORPUS_BLOCK_SIZE) corpus->block_size = CORPUS_BLOCK_SIZE;
+    corpus->words = buffer_alloc(capacity * sizeof(char*), memory);
+    if (!corpus->words) {
+        perror("Memory allocation failed");
+        free(corpus);
+        fclose(file);
+        return NULL;
+    }
+
+    char buffer[MAX_WORD_LENGTH];
+    size_t block_used = 0;
+
+    // Read words with dynamic reallocation, the words themselves are packed
+    // into large blocks rather than allocated one by one
+    while (fscanf(file, "%59s", buffer) == 1) {
+        if (corpus->total_words >= capacity) {
+            char **temp = buffer_realloc(corpus->words, capacity * sizeof(char*),
+                                         capacity * GROWTH_FACTOR * sizeof(char*), memory);
+            if (!temp) {
+                perror("Memory reallocation failed");
+                wc_corpus_close(corpus);
+                fclose(file);
+                return NULL;
+            }
+            corpus->words = temp;
+            capacity *= GROWTH_FACTOR;
+        }
+
+        char *word = store_word(corpus, &block_used, buffer, memory);
+        if (!word) {
+            perror("Memory allocation failed");
+            wc_corpus_close(corpus);
+            fclose(file);
+            return NULL;
+        }
+        corpus->words[corpus->total_words++] = word;
+    }
+
+    fclose(file);
+    return corpus;
+}
+
+int wc_corpus_size(const WordCorpus *corpus) {
+    return corpus->total_words;
+}
+
+void wc_corpus_close(WordCorpus *corpus) {
+    if (!corpus) {
+        return;
+    }
+    for (int i = 0; i < corpus->num_blocks; i++) {
+        buffer_free(corpus->blocks[i]);
+    }
+    free(corpus->blocks);
+    buffer_free(corpus->words);
+    free(corpus);
+}
+
+WordCountResult* wc_count(const WordCorpus *corpus, const WordCountOptions *options) {
+    WordCountResult *result = calloc(1, sizeof(WordCountResult));
+    if (!result) {
+        perror("Memory allocation failed");
+        return NULL;
+    }
+    WordCountStats *stats = &result->stats;
+    stats->total_words = corpus->total_words;
+    stats->memory_domains = count_memory_domains();
+    stats->chunks_per_worker = options->chunks_per_worker > 1 ? options->chunks_per_worker : 1;
+
+    int workers = options->workers > 0 ? options->workers : DEFAULT_WORKERS;
+    WordFreqArray word_freq;
+    word_freq.data = NULL;
+    int ok;
+    long long faults = minor_faults();
+    int dtlb_counter = open_dtlb_counter();
+
+    switch (options->engine) {
+    case WC_ENGINE_NAIVE:
+        stats->processes = stats->threads_per_process = 1;
+        ok = count_naive(corpus, options->memory, &word_freq, stats);
+        break;
+
+    case WC_ENGINE_INDEXED:
+        stats->processes = stats->threads_per_process = 1;
+        ok = count_indexed(corpus, options->memory, &word_freq, stats);
+        break;
+
+    case WC_ENGINE_THREADS:
+        if (workers > MAX_THREADS) workers = MAX_THREADS;
+        stats->processes = 1;
+        stats->threads_per_process = workers;
+        ok = count_threads(corpus, workers, options->chunks_per_worker, options->memory,
+                           &word_freq, stats);
+        break;
+
+    case WC_ENGINE_PROCESSES:
+        if (workers > MAX_PROCESSES) workers = MAX_PROCESSES;
+        stats->processes = workers;
+        stats->threads_per_process = 1;
+        ok = count_with_processes(corpus, workers, 1, options->chunks_per_worker, options->memory,
+                                  &word_freq, stats);
+        break;
+
+    case WC_ENGINE_HYBRID: {
+        // Default split: one process per memory domain, its share of the CPUs as threads
+        int processes = options->workers > 0 ? options->workers : stats->memory_domains;
+        if (processes > MAX_PROCESSES) processes = MAX_PROCESSES;
+        int threads = options->threads_per_process;
+        if (threads <= 0) {
+            threads = (int)(sysconf(_SC_NPROCESSORS_ONLN) / processes);
+        }
+        if (threads < 1) threads = 1;
+        if (threads > MAX_THREADS) threads = MAX_THREADS;
+        stats->processes = processes;
+        stats->threads_per_process = threads;
+        ok = count_with_processes(corpus, processes, threads, options->chunks_per_worker,
+                                  options->memory, &word_freq, stats);
+        break;
+    }
+
+    default:
+        ok = 0;
+        break;
+    }
+
+    stats->dtlb_misses = read_dtlb_counter(dtlb_counter);
+    stats->page_faults = minor_faults() - faults;
+    if (!ok) {
+        buffer_free(word_freq.data);
+        free(result);
+        return NULL;
+    }
+
+    // Rank words by frequency
+    double sorting = now_seconds();
+    if (!rank_word_freq(&word_freq)) {
+        buffer_free(word_freq.data);
+        free(result);
+        return NULL;
+    }
+    stats->sort_seconds = now_seconds() - sorting;
+    result->data = word_freq.data;
+    result->size = word_freq.size;
+    if (!build_result_index(result)) {
+        buffer_free(result->data);
+        free(result);
+        return NULL;
+    }
+
+    stats->distinct_words = result->size;
+    stats->peak_rss_mb = peak_rss_mb(RUSAGE_SELF);
+    stats->peak_child_rss_mb = peak_rss_mb(RUSAGE_CHILDREN);
+    return result;
+}
+
+int wc_result_size(const WordCountResult *result) {
+    return result->size;
+}
+
+int wc_top_k(const WordCountResult *result, int k, WordCount *out) {
+    int limit = (k < result->size) ? k : result->size;
+    for (int i = 0; i < limit; i++) {
+        out[i].word = result->data[i].word;
+        out[i].frequency = result->data[i].frequency;
+    }
+    return limit;
+}
+
+int wc_lookup(const WordCountResult *result, const char *word) {
+    size_t slot = find_index_slot(result->index, result->index_mask, result->data, word);
+    int position = result->index[slot];
+    return position ? result->data[position - 1].frequency : 0;
+}
+
+const WordCountStats* wc_result_stats(const WordCountResult *result) {
+    return &result->stats;
+}
+
+int wc_write_counts(const WordCountResult *result, const char *filename) {
+    return wc_export_ranking(result, filename, WC_FORMAT_TSV);
+}
+
+static void export_flush(ExportBuffer *out) {
+    if (out->used > 0 && fwrite(out->data, 1, out->used, out->file) != out->used) {
+        out->failed = 1;
+    }
+    out->used = 0;
+}
+
+static void export_write(ExportBuffer *out, const void *bytes, size_t length) {
+    if (out->used + length > EXPORT_BUFFER_SIZE) {
+        export_flush(out);
+    }
+    memcpy(out->data + out->used, bytes, length);
+    out->used += length;
+}
+
+// Format "word\tfrequency\n" into `line`, returns its length
+static size_t format_tsv_line(char *line, const WordFreq *entry) {
+    size_t length = strlen(entry->word);
+    memcpy(line, entry->word, length);
+    line[length++] = '\t';
+
+    char digits[16];
+    int num_digits = 0;
+    unsigned int frequency = (unsigned int)entry->frequency;
+    do {
+        digits[num_digits++] = '0' + frequency % 10;
+        frequency /= 10;
+    } while (frequency > 0);
+    while (num_digits > 0) {
+        line[length++] = digits[--num_digits];
+    }
+    line[length++] = '\n';
+    return length;
+}
+
+int wc_export_ranking(const WordCountResult *result, const char *filename, WordCountFormat format) {
+    FILE *file = fopen(filename, format == WC_FORMAT_BINARY ? "wb" : "w");
+    if (!file) {
+        perror("Error opening counts file");
+        return 0;
+    }
+    ExportBuffer out = {file, malloc(EXPORT_BUFFER_SIZE), 0, 0};
+    if (!out.data) {
+        perror("Memory allocation failed");
+        fclose(file);
+        return 0;
+    }
+
+    if (format == WC_FORMAT_BINARY) {
+        uint32_t entries = (uint32_t)result->size;
+        export_write(&out, RANKING_MAGIC, strlen(RANKING_MAGIC));
+        export_write(&out, &entries, sizeof(entries));
+    }
+    for (int i = 0; i < result->size; i++) {
+        const WordFreq *entry = &result->data[i];
+        if (format == WC_FORMAT_BINARY) {
+            uint32_t frequency = (uint32_t)entry->frequency;
+            uint16_t length = (uint16_t)strlen(entry->word);
+            export_write(&out, &frequency, sizeof(frequency));
+            export_write(&out, &length, sizeof(length));
+            export_write(&out, entry->word, length);
+        } else {
+            char line[MAX_WORD_LENGTH + 16];
+            export_write(&out, line, format_tsv_line(line, entry));
+        }
+    }
+    export_flush(&out);
+    free(out.data);
+
+    if (fclose(file) != 0 || out.failed) {
+        perror("Error writing counts file");
+        return 0;
+    }
+    return 1;
+}
+
+void wc_result_free(WordCountResult *result) {
+    if (!result) {
+        return;
+    }
+    buffer_free(result->data);
+    free(result->index);
+    free(result);
+}
+
+// How calibration timings on the sample scale to the full corpus. Tables are
+// scanned linearly, so counting grows with tokens times vocabulary and merging
+// local tables into the shared one with the vocabulary squared.
+typedef struct {
+    double tokens;                      // full corpus words / sample words
+    double vocabulary;                  // estimated full vocabulary / sample vocabulary
+} TuneScale;
+
+static const char *engine_names[] = {"naive", "threads", "processes", "hybrid", "indexed"};
+
+// Shallow sample of about `sample_words` words taken in evenly spaced spans,
+// so it sees the vocabulary of the whole corpus rather than of its start;
+// 0 if there is no memory for it
+static int build_tune_sample(const WordCorpus *corpus, int sample_words, WordCorpus *sample) {
+    int span = sample_words / TUNE_SAMPLE_SPANS;
+    if (span < 1) span = 1;
+    sample->words = malloc((size_t)span * TUNE_SAMPLE_SPANS * sizeof(char*));
+    if (!sample->words) {
+        perror("Memory allocation failed");
+        return 0;
+    }
+    sample->total_words = 0;
+    sample->blocks = NULL;
+    sample->num_blocks = 0;
+    for (int i = 0; i < TUNE_SAMPLE_SPANS; i++) {
+        int start = (int)((long long)corpus->total_words * i / TUNE_SAMPLE_SPANS);
+        for (int j = start; j < start + span && j < corpus->total_words; j++) {
+            sample->words[sample->total_words++] = corpus->words[j];
+        }
+    }
+    return 1;
+}
+
+// Predicted full-corpus wall time of a calibration pass, and its serial share
+static double predict_seconds(const WordCountStats *stats, double measured,
+                              const TuneScale *scale, double *serial_fraction) {
+    double setup = stats->setup_seconds * scale->tokens;
+    double count = stats->count_seconds * scale->tokens * scale->vocabulary;
+    double merge = stats->merge_seconds * scale->vocabulary * scale->vocabulary;
+    double sort = stats->sort_seconds * scale->vocabulary;
+    // Thread and process start-up, index building: does not scale
+    double overhead = measured - stats->setup_seconds - stats->count_seconds -
+                      stats->merge_seconds - stats->sort_seconds;
+    if (overhead < 0) overhead = 0;
+
+    double total = setup + count + merge + sort + overhead;
+    *serial_fraction = total > 0 ? (total - count) / total : 0.0;
+    return total;
+}
+
+// Best of a few calibration passes of `options` on the sample, returns its
+// predicted full-corpus time. The first pass fixes the vocabulary scale.
+static double run_tune_trial(const WordCorpus *sample, const WordCountOptions *options,
+                             double estimated_distinct, TuneScale *scale, FILE *report) {
+    double best = -1.0, best_measured = 0.0, best_serial = 0.0;
+    for (int repeat = 0; repeat < TUNE_REPEATS; repeat++) {
+        double start = now_seconds();
+        WordCountResult *result = wc_count(sample, options);
+        if (!result) {
+            return -1.0;
+        }
+        double measured = now_seconds() - start;
+        if (scale->vocabulary <= 0) {
+            int sample_distinct = result->stats.distinct_words > 0 ? result->stats.distinct_words : 1;
+            scale->vocabulary = estimated_distinct > sample_distinct
+                              ? estimated_distinct / sample_distinct : 1.0;
+        }
+        double serial;
+        double predicted = predict_seconds(&result->stats, measured, scale, &serial);
+        if (best < 0 || predicted < best) {
+            best = predicted;
+            best_measured = measured;
+            best_serial = serial;
+        }
+        wc_result_free(result);
+    }
+    if (report) {
+        fprintf(report, "  %3d %s x %3d chunks: sample %.4f s, serial %5.1f%%, predicted %.4f s\n",
+                options->engine == WC_ENGINE_HYBRID ? options->threads_per_process : options->workers,
+                options->engine == WC_ENGINE_HYBRID ? "threads/process" : "workers",
+                options->chunks_per_worker > 1 ? options->chunks_per_worker : 1,
+                best_measured, 100.0 * best_serial, best);
+    }
+    return best;
+}
+
+int wc_autotune(const WordCorpus *corpus, WordCountEngine engine, int sample_words,
+                WordCountOptions *best, FILE *report) {
+    // The hybrid engine tunes threads for the caller's process count
+    int processes = engine == WC_ENGINE_HYBRID ? best->workers : 0;
+    if (processes <= 0 || processes > MAX_PROCESSES) {
+        processes = engine == WC_ENGINE_HYBRID ? count_memory_domains() : 1;
+    }
+    memset(best, 0, sizeof(*best));
+    best->engine = engine;
+    best->workers = 1;
+    best->threads_per_process = 1;
+    if (engine < WC_ENGINE_NAIVE || engine > WC_ENGINE_INDEXED) {
+        return 0;
+    }
+    // Sequential engines have nothing to tune
+    if (engine == WC_ENGINE_NAIVE || engine == WC_ENGINE_INDEXED || corpus->total_words == 0) {
+        return 1;
+    }
+    if (sample_words <= 0) {
+        sample_words = TUNE_SAMPLE_WORDS;
+    }
+    // Spans of a larger sample would overlap and count words twice
+    if (sample_words > corpus->total_words) {
+        sample_words = corpus->total_words;
+    }
+
+    WordCorpus sample;
+    if (!build_tune_sample(corpus, sample_words, &sample)) {
+        return 0;
+    }
+
+    // The full vocabulary decides how table scans and merges scale
+    double estimated_distinct = sketch_corpus(corpus);
+    if (estimated_distinct < 0) {
+        free(sample.words);
+        return 0;
+    }
+
+    TuneScale scale = {(double)corpus->total_words / sample.total_words, 0.0};
+    int cpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1) cpus = 1;
+    int limit = engine == WC_ENGINE_PROCESSES ? MAX_PROCESSES : MAX_THREADS;
+    int max_workers = 2 * cpus / processes;
+    if (max_workers < 1) max_workers = 1;
+    if (max_workers > limit) max_workers = limit;
+    if (report) {
+        fprintf(report, "Auto-tuning %s on %d of %d words (%d CPUs, ~%.0f distinct words):\n",
+                engine_names[engine], sample.total_words, corpus->total_words, cpus,
+                estimated_distinct);
+    }
+
+    // Worker count: powers of two up to twice the CPUs, and the CPU count itself
+    int candidates[32];
+    int num_candidates = 0;
+    for (int workers = 1; workers <= max_workers; workers *= 2) {
+        candidates[num_candidates++] = workers;
+    }
+    int per_process = cpus / processes;
+    if (per_process > 1 && (per_process & (per_process - 1)) != 0) {
+        candidates[num_candidates++] = per_process;
+    }
+
+    double best_seconds = -1.0;
+    WordCountOptions trial = *best;
+    trial.workers = processes;
+    for (int i = 0; i < num_candidates; i++) {
+        if (engine == WC_ENGINE_HYBRID) {
+            trial.threads_per_process = candidates[i];
+        } else {
+            trial.workers = candidates[i];
+        }
+        double predicted = run_tune_trial(&sample, &trial, estimated_distinct, &scale, report);
+        if (predicted >= 0 && (best_seconds < 0 || predicted < best_seconds)) {
+            best_seconds = predicted;
+            *best = trial;
+        }
+    }
+
+    // Chunk granularity for the chosen worker count
+    for (int chunks = 4; chunks <= 64; chunks *= 4) {
+        trial = *best;
+        trial.chunks_per_worker = chunks;
+        double predicted = run_tune_trial(&sample, &trial, estimated_distinct, &scale, report);
+        if (predicted >= 0 && predicted < best_seconds) {
+            best_seconds = predicted;
+            *best = trial;
+        }
+    }
+    free(sample.words);
+    return best_seconds >= 0;
+}
+
+int wc_save_options(const char *filename, const WordCountOptions *options) {
+    if (options->engine < WC_ENGINE_NAIVE || options->engine > WC_ENGINE_INDEXED) {
+        return 0;
+    }
+    FILE *file = fopen(filename, "w");
+    if (!file) {
+        perror("Error opening tuning file");
+        return 0;
+    }
+    fprintf(file, "engine=%s\n", engine_names[options->engine]);
+    fprintf(file, "cpus=%ld\n", sysconf(_SC_NPROCESSORS_ONLN));
+    fprintf(file, "workers=%d\n", options->workers);
+    fprintf(file, "threads_per_process=%d\n", options->threads_per_process);
+    fprintf(file, "chunks_per_worker=%d\n", options->chunks_per_worker);
+    fclose(file);
+    return 1;
+}
+
+int wc_load_options(const char *filename, WordCountEngine engine, WordCountOptions *options) {
+    FILE *file = fopen(filename, "r");
+    if (!file) {
+        return 0;
+    }
+    char key[64], value[64];
+    int engine_matches = 0;
+    long cpus = -1;
+    WordCountOptions loaded = {engine, 0, 0, 0, 0};
+    while (fscanf(file, " %63[^=]=%63s", key, value) == 2) {
+        if (strcmp(key, "engine") == 0) {
+            engine_matches = engine >= WC_ENGINE_NAIVE && engine <= WC_ENGINE_INDEXED &&
+                             strcmp(value, engine_names[engine]) == 0;
+        } else if (strcmp(key, "cpus") == 0) {
+            cpus = atol(value);
+        } else if (strcmp(key, "workers") == 0) {
+            loaded.workers = atoi(value);
+        } else if (strcmp(key, "threads_per_process") == 0) {
+            loaded.threads_per_process = atoi(value);
+        } else if (strcmp(key, "chunks_per_worker") == 0) {
+            loaded.chunks_per_worker = atoi(value);
+        }
+    }
+    fclose(file);
+
+    // A configuration tuned on a different host or for another engine is stale
+    if (!engine_matches || cpus != sysconf(_SC_NPROCESSORS_ONLN)) {
+        return 0;
+    }
+    *options = loaded;
+    return 1;
+}
+
+int wc_memory_flags(const char *spec) {
+    int memory = 0;
+    if (spec && strstr(spec, "huge")) {
+        memory |= WC_MEMORY_HUGE_PAGES;
+    }
+    if (spec && strstr(spec, "prefault")) {
+        memory |= WC_MEMORY_PREFAULT;
+    }
+    return memory;
+}
+
+const char* wc_pages_name(WordCountPages pages) {
+    switch (pages) {
+    case WC_PAGES_TRANSPARENT: return "transparent huge pages";
+    case WC_PAGES_HUGETLB: return "hugetlb pages";
+    default: return "base pages";
+    }
+}
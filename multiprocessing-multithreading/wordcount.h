@@ -0,0 +1,166 @@
+#ifndef WORDCOUNT_H
+#define WORDCOUNT_H
+
+/*
+ * Word frequency counting library shared by the naive, multithreading,
+ * multiprocessing and hybrid front-ends and the query daemon.
+ *
+ * Typical use:
+ *
+ *   WordCorpus *corpus = wc_corpus_open("text8.txt");
+ *   WordCountOptions options = {WC_ENGINE_THREADS, 8, 0};
+ *   WordCountResult *result = wc_count(corpus, &options);
+ *   WordCount top[10];
+ *   int n = wc_top_k(result, 10, top);
+ *   int the = wc_lookup(result, "the");
+ *   wc_result_free(result);
+ *   wc_corpus_close(corpus);
+ *
+ * A corpus can be counted any number of times, with any engine, and a result
+ * stays valid after its corpus is closed. The process engines fork, so call
+ * them before the host process starts threads of its own.
+ *
+ * Instead of fixing the worker count, a front-end can calibrate it on the
+ * host and keep the answer for later runs:
+ *
+ *   WordCountOptions options = {WC_ENGINE_THREADS, 0, 0, 0, 0};
+ *   if (!wc_load_options("wordcount.tune", WC_ENGINE_THREADS, &options)) {
+ *       wc_autotune(corpus, WC_ENGINE_THREADS, 0, &options, stdout);
+ *       wc_save_options("wordcount.tune", &options);
+ *   }
+ *
+ * The structs below are part of the shared library's ABI. WordCountStats is
+ * only ever handed out by pointer, so new fields are appended to it without
+ * a bump. WordCountOptions and WordCount are allocated by callers, and any
+ * change to them, appending included, bumps ABI_VERSION in the Makefile and
+ * with it the SONAME; so does any other change to WordCountStats.
+ */
+
+#include <stdio.h>
+
+#define WORDCOUNT_API_VERSION 5
+#define WC_MAX_WORD_LENGTH 60
+
+// Memory backend flags for the corpus and the counting tables
+#define WC_MEMORY_HUGE_PAGES 1    // MAP_HUGETLB, else transparent huge pages via madvise
+#define WC_MEMORY_PREFAULT 2      // fault large buffers in up front, in parallel
+
+typedef enum {
+    WC_ENGINE_NAIVE,       // sequential, single thread
+    WC_ENGINE_THREADS,     // pthreads sharing one table
+    WC_ENGINE_PROCESSES,   // forked children merging through shared memory
+    WC_ENGINE_HYBRID,      // forked processes, each running a thread pool
+    WC_ENGINE_INDEXED      // sequential, words found through a hash index
+} WordCountEngine;
+
+// Layout of a full ranking export
+typedef enum {
+    WC_FORMAT_TSV,         // "word\tfrequency" lines
+    WC_FORMAT_BINARY       // "WCRANK1\n", uint32 count, then per word uint32
+                           // frequency, uint16 length and the bytes, host order
+} WordCountFormat;
+
+// Pages actually backing the large buffers of a run
+typedef enum {
+    WC_PAGES_SMALL,        // base pages
+    WC_PAGES_TRANSPARENT,  // transparent huge pages requested with madvise
+    WC_PAGES_HUGETLB       // huge pages reserved from the hugetlb pool
+} WordCountPages;
+
+typedef struct {
+    WordCountEngine engine;
+    int workers;              // threads or processes, 0 picks a default
+    int threads_per_process;  // hybrid only, 0 splits the online CPUs
+    int chunks_per_worker;    // chunks each worker claims dynamically, 0 or 1 splits statically
+    int memory;               // WC_MEMORY_* flags for the counting tables
+} WordCountOptions;
+
+// One word and its frequency, `word` points into the result
+typedef struct {
+    const char *word;
+    int frequency;
+} WordCount;
+
+// What a counting run did, for reporting
+typedef struct {
+    int total_words;
+    int distinct_words;
+    double estimated_distinct;  // HyperLogLog estimate used to size the tables
+    int dropped_words;          // distinct words lost to a full shared table
+    long long cache_hits;       // tokens counted by the hot-word caches
+    long long cache_flushes;
+    int processes;
+    int threads_per_process;
+    int memory_domains;
+    double peak_rss_mb;
+    double peak_child_rss_mb;
+    int chunks_per_worker;
+    double setup_seconds;       // serial: sketching and table setup before the workers start
+    double count_seconds;       // parallel: until the last worker finished counting
+    double merge_seconds;       // serialized merges into the shared table
+    double sort_seconds;        // parallel radix ranking of the merged table
+    WordCountPages pages;       // backing of the table the workers merge into
+    long long page_faults;      // minor faults, children included
+    long long dtlb_misses;      // dTLB load misses, children included; -1 if unavailable
+} WordCountStats;
+
+typedef struct WordCorpus WordCorpus;
+typedef struct WordCountResult WordCountResult;
+
+// Read every whitespace-separated word of a file, NULL on failure
+WordCorpus* wc_corpus_open(const char *filename);
+
+// Same, with the words held in buffers from the WC_MEMORY_* backend
+WordCorpus* wc_corpus_load(const char *filename, int memory);
+int wc_corpus_size(const WordCorpus *corpus);
+void wc_corpus_close(WordCorpus *corpus);
+
+// Count word frequencies with the chosen engine, NULL on failure
+WordCountResult* wc_count(const WordCorpus *corpus, const WordCountOptions *options);
+
+// Number of distinct words in the result
+int wc_result_size(const WordCountResult *result);
+
+// Results are ranked by frequency, most frequent first; ties keep the order in
+// which the words first occur in the corpus, so every engine ranks alike.
+
+// Copy up to k most frequent words into `out`, returns how many were copied
+int wc_top_k(const WordCountResult *result, int k, WordCount *out);
+
+// Frequency of a word, 0 if it does not occur
+int wc_lookup(const WordCountResult *result, const char *word);
+
+const WordCountStats* wc_result_stats(const WordCountResult *result);
+
+// Write every word and its frequency, most frequent first, as TSV
+int wc_write_counts(const WordCountResult *result, const char *filename);
+
+// Stream the full ranking to a file in the given format with buffered writes
+int wc_export_ranking(const WordCountResult *result, const char *filename, WordCountFormat format);
+
+void wc_result_free(WordCountResult *result);
+
+// Pick the worker count (threads per process for the hybrid engine) and chunk
+// granularity that minimise the predicted wall time of `engine` on this host.
+// Calibration passes run on a sample of `sample_words` (0 picks a default)
+// drawn across the corpus; their serial and parallel phases are scaled to the
+// full corpus. Every trial is printed to `report` unless it is NULL. For the
+// hybrid engine a process count already set in `best->workers` is kept and
+// only the threads per process are tuned; 0 picks one per memory domain.
+// Returns 1 on success.
+int wc_autotune(const WordCorpus *corpus, WordCountEngine engine, int sample_words,
+                WordCountOptions *best, FILE *report);
+
+// WC_MEMORY_* flags named in a spec such as "huge,prefault", 0 for NULL
+int wc_memory_flags(const char *spec);
+
+// Printable name of a page backing
+const char* wc_pages_name(WordCountPages pages);
+
+// Persist tuned options, keyed to the engine and this host's online CPUs
+int wc_save_options(const char *filename, const WordCountOptions *options);
+
+// Load options saved for `engine` on a host like this one, 0 if there are none
+int wc_load_options(const char *filename, WordCountEngine engine, WordCountOptions *options);
+
+#endif
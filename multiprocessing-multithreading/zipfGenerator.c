@@ -0,0 +1,207 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <unistd.h>
+
+#define MAX_WORD_LENGTH 60
+#define WORDS_PER_LINE 20
+#define OUTPUT_BUFFER_SIZE (1 << 20)
+
+/*
+ * Reproducible synthetic corpus generator. Draws `tokens` words from a
+ * vocabulary of `vocab` distinct words whose rank-frequency follows a Zipf
+ * law with exponent `s` (P(rank r) ~ 1 / r^s). Word lengths are drawn per
+ * vocabulary entry from the chosen distribution around a mean length; every
+ * word ends in a fixed-width base-26 encoding of its rank so words are
+ * always distinct, which makes words at least that width long.
+ * The same options and seed always produce the same bytes.
+ */
+
+typedef enum {
+    LENGTH_FIXED,
+    LENGTH_UNIFORM,
+    LENGTH_GEOMETRIC
+} LengthDistribution;
+
+static uint64_t rng_state;
+
+// splitmix64, portable and reproducible across platforms
+uint64_t next_random(void) {
+    uint64_t z = (rng_state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Uniform double in [0, 1)
+double next_uniform(void) {
+    return (next_random() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Draw a word length around `mean` from the requested distribution
+int draw_length(LengthDistribution dist, int mean) {
+    int length = mean;
+    switch (dist) {
+    case LENGTH_FIXED:
+        break;
+    case LENGTH_UNIFORM:
+        length = 1 + (int)(next_uniform() * (2 * mean - 1));
+        break;
+    case LENGTH_GEOMETRIC:
+        length = 1 + (int)(log(1.0 - next_uniform()) / log(1.0 - 1.0 / mean));
+        break;
+    }
+    if (length < 1) length = 1;
+    if (length > MAX_WORD_LENGTH - 1) length = MAX_WORD_LENGTH - 1;
+    return length;
+}
+
+// Build vocabulary entry `rank`: random letters followed by the rank in base 26
+// Number of base-26 digits needed to encode every rank below `vocab`
+int rank_code_width(int vocab) {
+    int width = 1;
+    for (long long limit = 26; limit < vocab; limit *= 26) {
+        width++;
+    }
+    return width;
+}
+
+// Random prefix followed by the rank in exactly `code_len` base-26 digits;
+// equal words would need equal suffixes, so distinct ranks never collide
+void make_word(char *word, int rank, int length, int code_len) {
+    char code[16];
+    int r = rank;
+    for (int i = 0; i < code_len; i++) {
+        code[i] = 'a' + r % 26;
+        r /= 26;
+    }
+
+    int prefix = length > code_len ? length - code_len : 0;
+    for (int i = 0; i < prefix; i++) {
+        word[i] = 'a' + next_random() % 26;
+    }
+    for (int i = 0; i < code_len; i++) {
+        word[prefix + i] = code[code_len - 1 - i];
+    }
+    word[prefix + code_len] = '\0';
+}
+
+// Cumulative Zipf distribution over ranks 1..vocab
+double* build_zipf_cdf(int vocab, double exponent) {
+    double *cdf = malloc(vocab * sizeof(double));
+    if (!cdf) {
+        perror("Memory allocation failed");
+        exit(1);
+    }
+    double total = 0.0;
+    for (int r = 0; r < vocab; r++) {
+        total += 1.0 / pow(r + 1, exponent);
+        cdf[r] = total;
+    }
+    for (int r = 0; r < vocab; r++) {
+        cdf[r] /= total;
+    }
+    return cdf;
+}
+
+// Binary search the first rank whose cumulative probability exceeds u
+int sample_rank(const double *cdf, int vocab, double u) {
+    int lo = 0, hi = vocab - 1;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (cdf[mid] > u) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+void print_usage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s [-n tokens] [-v vocab] [-s exponent] [-l mean_length]\n"
+            "          [-d fixed|uniform|geometric] [-r seed] [-o output]\n", program);
+}
+
+int main(int argc, char *argv[]) {
+    long long tokens = 1000000;
+    int vocab = 10000;
+    double exponent = 1.0;
+    int mean_length = 6;
+    LengthDistribution dist = LENGTH_GEOMETRIC;
+    uint64_t seed = 42;
+    const char *output_path = NULL;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:v:s:l:d:r:o:")) != -1) {
+        switch (opt) {
+        case 'n': tokens = atoll(optarg); break;
+        case 'v': vocab = atoi(optarg); break;
+        case 's': exponent = atof(optarg); break;
+        case 'l': mean_length = atoi(optarg); break;
+        case 'd':
+            if (strcmp(optarg, "fixed") == 0) dist = LENGTH_FIXED;
+            else if (strcmp(optarg, "uniform") == 0) dist = LENGTH_UNIFORM;
+            else if (strcmp(optarg, "geometric") == 0) dist = LENGTH_GEOMETRIC;
+            else {
+                print_usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'r': seed = strtoull(optarg, NULL, 10); break;
+        case 'o': output_path = optarg; break;
+        default:
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (tokens < 0 || vocab < 1 || exponent < 0 || mean_length < 1 ||
+        mean_length > MAX_WORD_LENGTH - 1) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    FILE *output = stdout;
+    if (output_path) {
+        output = fopen(output_path, "w");
+        if (!output) {
+            perror("Error opening output file");
+            return 1;
+        }
+    }
+    static char output_buffer[OUTPUT_BUFFER_SIZE];
+    setvbuf(output, output_buffer, _IOFBF, sizeof(output_buffer));
+
+    // Vocabulary: one word per rank, stored back to back
+    rng_state = seed;
+    char *words = malloc((size_t)vocab * MAX_WORD_LENGTH);
+    if (!words) {
+        perror("Memory allocation failed");
+        return 1;
+    }
+    int code_width = rank_code_width(vocab);
+    for (int r = 0; r < vocab; r++) {
+        make_word(words + (size_t)r * MAX_WORD_LENGTH, r, draw_length(dist, mean_length), code_width);
+    }
+
+    double *cdf = build_zipf_cdf(vocab, exponent);
+
+    for (long long i = 0; i < tokens; i++) {
+        int rank = sample_rank(cdf, vocab, next_uniform());
+        fputs(words + (size_t)rank * MAX_WORD_LENGTH, output);
+        fputc((i + 1) % WORDS_PER_LINE == 0 ? '\n' : ' ', output);
+    }
+    fputc('\n', output);
+
+    if (output != stdout) {
+        fclose(output);
+    } else {
+        fflush(output);
+    }
+    free(cdf);
+    free(words);
+    return 0;
+}